@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * approximateMatchingAlgorithms.c
+ *
+ * Fast approximate maximum weight matching algorithms, alternatives to the greedy and blossom5 algorithms
+ * for very large graphs.
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sonLib.h"
+#include "shared.h"
+
+/*
+ * Adjacency structure, giving for each node the indices of its incident edges.
+ */
+
+typedef struct _matchingGraph {
+    int64_t nodeNumber;
+    int64_t edgeNumber;
+    stList *edges;
+    packedEdge *packedEdges; //The edges, packed, by index in the edge list.
+    int64_t *offsets; //The edges incident with node n are incidentEdges[offsets[n]] to incidentEdges[offsets[n+1]-1].
+    int64_t *incidentEdges;
+} matchingGraph;
+
+static matchingGraph *matchingGraph_construct(stList *edges, int64_t nodeNumber) {
+    matchingGraph *g = st_malloc(sizeof(matchingGraph));
+    g->nodeNumber = nodeNumber;
+    g->edgeNumber = stList_length(edges);
+    g->edges = edges;
+    g->packedEdges = getPackedEdges(edges);
+    g->offsets = st_calloc(nodeNumber + 1, sizeof(int64_t));
+    g->incidentEdges = st_malloc(sizeof(int64_t) * (2 * g->edgeNumber + 1));
+    for (int64_t i = 0; i < g->edgeNumber; i++) {
+        assert(g->packedEdges[i].node1 >= 0 && g->packedEdges[i].node1 < nodeNumber);
+        assert(g->packedEdges[i].node2 >= 0 && g->packedEdges[i].node2 < nodeNumber);
+        assert(g->packedEdges[i].node1 != g->packedEdges[i].node2);
+        g->offsets[g->packedEdges[i].node1 + 1]++;
+        g->offsets[g->packedEdges[i].node2 + 1]++;
+    }
+    for (int64_t n = 0; n < nodeNumber; n++) {
+        g->offsets[n + 1] += g->offsets[n];
+    }
+    int64_t *fill = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    memcpy(fill, g->offsets, sizeof(int64_t) * (nodeNumber + 1));
+    for (int64_t i = 0; i < g->edgeNumber; i++) {
+        g->incidentEdges[fill[g->packedEdges[i].node1]++] = i;
+        g->incidentEdges[fill[g->packedEdges[i].node2]++] = i;
+    }
+    free(fill);
+    return g;
+}
+
+static void matchingGraph_destruct(matchingGraph *g) {
+    free(g->packedEdges);
+    free(g->offsets);
+    free(g->incidentEdges);
+    free(g);
+}
+
+static inline int64_t matchingGraph_otherNode(matchingGraph *g, int64_t edge, int64_t node) {
+    assert(g->packedEdges[edge].node1 == node || g->packedEdges[edge].node2 == node);
+    return g->packedEdges[edge].node1 == node ? g->packedEdges[edge].node2 : g->packedEdges[edge].node1;
+}
+
+static inline bool matchingGraph_heavier(matchingGraph *g, int64_t edge1, int64_t edge2) {
+    /*
+     * Edges are totally ordered by weight, with ties broken by index, so that the locally dominant edges are unique.
+     */
+    return edge2 == -1 || g->packedEdges[edge1].weight > g->packedEdges[edge2].weight || (g->packedEdges[edge1].weight == g->packedEdges[edge2].weight && edge1 < edge2);
+}
+
+static stList *matchingGraph_getMatching(matchingGraph *g, int64_t *mates) {
+    /*
+     * Converts the array of matched edges, indexed by node, into a list of the matched edges in edge order.
+     */
+    stList *matching = stList_construct();
+    for (int64_t i = 0; i < g->edgeNumber; i++) {
+        if (mates[g->packedEdges[i].node1] == i) {
+            assert(mates[g->packedEdges[i].node2] == i);
+            stList_append(matching, stList_get(g->edges, i));
+        }
+    }
+    return matching;
+}
+
+static void matchingGraph_makeMaximal(matchingGraph *g, int64_t *mates) {
+    /*
+     * Adds any edges between unmatched nodes, heaviest first from each node.
+     */
+    for (int64_t n = 0; n < g->nodeNumber; n++) {
+        if (mates[n] == -1) {
+            int64_t bestEdge = -1;
+            for (int64_t j = g->offsets[n]; j < g->offsets[n + 1]; j++) {
+                int64_t edge = g->incidentEdges[j];
+                if (mates[matchingGraph_otherNode(g, edge, n)] == -1 && matchingGraph_heavier(g, edge, bestEdge)) {
+                    bestEdge = edge;
+                }
+            }
+            if (bestEdge != -1) {
+                mates[g->packedEdges[bestEdge].node1] = bestEdge;
+                mates[g->packedEdges[bestEdge].node2] = bestEdge;
+            }
+        }
+    }
+}
+
+/*
+ * Path growing algorithm, Drake and Hougardy 2003.
+ */
+
+static int64_t *getPathGrowingMates(matchingGraph *g) {
+    /*
+     * Grows paths from each node along the heaviest edge to a node not yet visited, alternately assigning the path
+     * edges to two matchings, and returns the heavier of the two, made maximal.
+     */
+    int64_t *mates[2] = { st_malloc(sizeof(int64_t) * (g->nodeNumber + 1)), st_malloc(sizeof(int64_t) * (g->nodeNumber + 1)) };
+    int64_t weights[2] = { 0, 0 };
+    bool *visited = st_calloc(g->nodeNumber + 1, sizeof(bool));
+    for (int64_t n = 0; n < g->nodeNumber; n++) {
+        mates[0][n] = -1;
+        mates[1][n] = -1;
+    }
+    for (int64_t n = 0; n < g->nodeNumber; n++) {
+        int64_t node = n, i = 0;
+        while (!visited[node]) {
+            visited[node] = 1;
+            int64_t bestEdge = -1;
+            for (int64_t j = g->offsets[node]; j < g->offsets[node + 1]; j++) {
+                int64_t edge = g->incidentEdges[j];
+                if (!visited[matchingGraph_otherNode(g, edge, node)] && matchingGraph_heavier(g, edge, bestEdge)) {
+                    bestEdge = edge;
+                }
+            }
+            if (bestEdge == -1) {
+                break;
+            }
+            mates[i][g->packedEdges[bestEdge].node1] = bestEdge;
+            mates[i][g->packedEdges[bestEdge].node2] = bestEdge;
+            weights[i] += g->packedEdges[bestEdge].weight;
+            i = 1 - i;
+            node = matchingGraph_otherNode(g, bestEdge, node);
+        }
+    }
+    free(visited);
+    int64_t best = weights[0] >= weights[1] ? 0 : 1;
+    free(mates[1 - best]);
+    matchingGraph_makeMaximal(g, mates[best]);
+    return mates[best];
+}
+
+stList *chooseMatching_pathGrowing(stList *edges, int64_t nodeNumber) {
+    matchingGraph *g = matchingGraph_construct(edges, nodeNumber);
+    int64_t *mates = getPathGrowingMates(g);
+    stList *matching = matchingGraph_getMatching(g, mates);
+    free(mates);
+    matchingGraph_destruct(g);
+    return matching;
+}
+
+/*
+ * Locally dominant edge algorithm, Preis 1999, in the parallel form of Manne and Bisseling 2007.
+ */
+
+typedef struct _locallyDominantState {
+    matchingGraph *g;
+    int64_t *mates; //Matched edge of each node, or -1.
+    int64_t *candidates; //Heaviest edge from each node to an unmatched node, or -1.
+    int64_t *workList; //Nodes whose candidates need computing.
+    int64_t workListLength;
+} locallyDominantState;
+
+typedef struct _locallyDominantJob {
+    locallyDominantState *lDS;
+    int64_t start, end; //Range of the work list.
+} locallyDominantJob;
+
+static void *setCandidates(void *arg) {
+    locallyDominantJob *job = arg;
+    locallyDominantState *lDS = job->lDS;
+    matchingGraph *g = lDS->g;
+    for (int64_t i = job->start; i < job->end; i++) {
+        int64_t node = lDS->workList[i];
+        int64_t bestEdge = -1;
+        for (int64_t j = g->offsets[node]; j < g->offsets[node + 1]; j++) {
+            int64_t edge = g->incidentEdges[j];
+            if (lDS->mates[matchingGraph_otherNode(g, edge, node)] == -1 && matchingGraph_heavier(g, edge, bestEdge)) {
+                bestEdge = edge;
+            }
+        }
+        lDS->candidates[node] = bestEdge;
+    }
+    return NULL;
+}
+
+//Work lists shorter than this are processed without starting extra threads.
+static const int64_t minimumNodesPerThread = 10000;
+
+static void setCandidatesInParallel(locallyDominantState *lDS, int64_t threadNumber) {
+    int64_t jobNumber = lDS->workListLength / minimumNodesPerThread;
+    jobNumber = jobNumber > threadNumber ? threadNumber : (jobNumber < 1 ? 1 : jobNumber);
+    locallyDominantJob *jobs = st_malloc(sizeof(locallyDominantJob) * jobNumber);
+    pthread_t *threads = st_malloc(sizeof(pthread_t) * jobNumber);
+    for (int64_t i = 0; i < jobNumber; i++) {
+        jobs[i].lDS = lDS;
+        jobs[i].start = (lDS->workListLength * i) / jobNumber;
+        jobs[i].end = (lDS->workListLength * (i + 1)) / jobNumber;
+    }
+    //The calling thread does the first job.
+    for (int64_t i = 1; i < jobNumber; i++) {
+        if (pthread_create(&threads[i], NULL, setCandidates, &jobs[i]) != 0) {
+            st_errAbort("Failed to create a thread to compute a matching");
+        }
+    }
+    setCandidates(&jobs[0]);
+    for (int64_t i = 1; i < jobNumber; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(jobs);
+    free(threads);
+}
+
+stList *chooseMatching_locallyDominant2(stList *edges, int64_t nodeNumber, int64_t threadNumber) {
+    /*
+     * Each node points at its heaviest edge to an unmatched node. Edges pointed at from both ends are locally dominant
+     * and are matched, then the nodes pointing at newly matched nodes are repointed, until no pointers remain.
+     * Pointers are computed in parallel, so the result does not depend on the number of threads.
+     */
+    assert(threadNumber >= 1);
+    matchingGraph *g = matchingGraph_construct(edges, nodeNumber);
+    locallyDominantState lDS;
+    lDS.g = g;
+    lDS.mates = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    lDS.candidates = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    lDS.workList = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    lDS.workListLength = nodeNumber;
+    int64_t *nextWorkList = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    bool *inNextWorkList = st_calloc(nodeNumber + 1, sizeof(bool));
+    for (int64_t n = 0; n < nodeNumber; n++) {
+        lDS.mates[n] = -1;
+        lDS.workList[n] = n;
+    }
+    while (lDS.workListLength > 0) {
+        setCandidatesInParallel(&lDS, threadNumber);
+        //Match the mutually pointing pairs, and collect the unmatched nodes that were pointing at the newly matched nodes.
+        int64_t nextWorkListLength = 0;
+        for (int64_t i = 0; i < lDS.workListLength; i++) {
+            int64_t node = lDS.workList[i];
+            int64_t edge = lDS.candidates[node];
+            if (edge == -1 || lDS.mates[node] != -1) {
+                continue;
+            }
+            int64_t otherNode = matchingGraph_otherNode(g, edge, node);
+            if (lDS.candidates[otherNode] != edge) {
+                continue;
+            }
+            lDS.mates[node] = edge;
+            lDS.mates[otherNode] = edge;
+            for (int64_t k = 0; k < 2; k++) {
+                int64_t matchedNode = k == 0 ? node : otherNode;
+                for (int64_t j = g->offsets[matchedNode]; j < g->offsets[matchedNode + 1]; j++) {
+                    int64_t adjacentNode = matchingGraph_otherNode(g, g->incidentEdges[j], matchedNode);
+                    if (lDS.mates[adjacentNode] == -1 && !inNextWorkList[adjacentNode]
+                            && lDS.candidates[adjacentNode] != -1
+                            && lDS.mates[matchingGraph_otherNode(g, lDS.candidates[adjacentNode], adjacentNode)] != -1) {
+                        inNextWorkList[adjacentNode] = 1;
+                        nextWorkList[nextWorkListLength++] = adjacentNode;
+                    }
+                }
+            }
+        }
+        //Nodes matched later in the pass may have been added to the next work list.
+        int64_t j = 0;
+        for (int64_t i = 0; i < nextWorkListLength; i++) {
+            inNextWorkList[nextWorkList[i]] = 0;
+            if (lDS.mates[nextWorkList[i]] == -1) {
+                nextWorkList[j++] = nextWorkList[i];
+            }
+        }
+        int64_t *workList = lDS.workList;
+        lDS.workList = nextWorkList;
+        lDS.workListLength = j;
+        nextWorkList = workList;
+    }
+    stList *matching = matchingGraph_getMatching(g, lDS.mates);
+    free(lDS.mates);
+    free(lDS.candidates);
+    free(lDS.workList);
+    free(nextWorkList);
+    free(inNextWorkList);
+    matchingGraph_destruct(g);
+    return matching;
+}
+
+stList *chooseMatching_locallyDominant(stList *edges, int64_t nodeNumber) {
+    int64_t threadNumber = sysconf(_SC_NPROCESSORS_ONLN);
+    return chooseMatching_locallyDominant2(edges, nodeNumber, threadNumber > 0 ? threadNumber : 1);
+}
+
+/*
+ * Improvement by short augmentations, after Drake and Hougardy 2005.
+ */
+
+static void addToBestTwo(int64_t gain, int64_t node, int64_t edge, int64_t *gains, int64_t *nodes, int64_t *edges) {
+    if (gain > gains[0]) {
+        gains[1] = gains[0];
+        nodes[1] = nodes[0];
+        edges[1] = edges[0];
+        gains[0] = gain;
+        nodes[0] = node;
+        edges[0] = edge;
+    } else if (gain > gains[1]) {
+        gains[1] = gain;
+        nodes[1] = node;
+        edges[1] = edge;
+    }
+}
+
+static void getBestTwoNeighbours(matchingGraph *g, int64_t *mates, int64_t node, int64_t mate, int64_t *gains,
+        int64_t *nodes, int64_t *edges) {
+    /*
+     * Gets the two neighbours of node, other than its mate, that give the greatest gain when matched with node: the
+     * weight of the edge less the weight of the neighbour's own matched edge, which would be removed.
+     */
+    for (int64_t i = 0; i < 2; i++) {
+        gains[i] = INT64_MIN;
+        nodes[i] = -1;
+        edges[i] = -1;
+    }
+    for (int64_t j = g->offsets[node]; j < g->offsets[node + 1]; j++) {
+        int64_t edge = g->incidentEdges[j];
+        int64_t otherNode = matchingGraph_otherNode(g, edge, node);
+        if (otherNode != mate) {
+            addToBestTwo(g->packedEdges[edge].weight - (mates[otherNode] == -1 ? 0 : g->packedEdges[mates[otherNode]].weight), otherNode, edge,
+                    gains, nodes, edges);
+        }
+    }
+}
+
+static void unmatch(matchingGraph *g, int64_t *mates, int64_t edge) {
+    mates[g->packedEdges[edge].node1] = -1;
+    mates[g->packedEdges[edge].node2] = -1;
+}
+
+static void match(matchingGraph *g, int64_t *mates, int64_t edge) {
+    if (mates[g->packedEdges[edge].node1] != -1) {
+        unmatch(g, mates, mates[g->packedEdges[edge].node1]);
+    }
+    if (mates[g->packedEdges[edge].node2] != -1) {
+        unmatch(g, mates, mates[g->packedEdges[edge].node2]);
+    }
+    mates[g->packedEdges[edge].node1] = edge;
+    mates[g->packedEdges[edge].node2] = edge;
+}
+
+static bool improveMatesByShortAugmentations(matchingGraph *g, int64_t *mates) {
+    /*
+     * For each matched edge (u, v) finds the best replacement of it by an edge (a, u) and/or an edge (v, b), removing the
+     * edges a and b were matched by, and applies it if it increases the weight. Returns non-zero if any were applied.
+     */
+    bool improved = 0;
+    int64_t uGains[2], uNodes[2], uEdges[2], vGains[2], vNodes[2], vEdges[2];
+    for (int64_t u = 0; u < g->nodeNumber; u++) {
+        int64_t edge = mates[u];
+        if (edge == -1 || g->packedEdges[edge].node1 != u) {
+            continue;
+        }
+        int64_t v = g->packedEdges[edge].node2;
+        getBestTwoNeighbours(g, mates, u, v, uGains, uNodes, uEdges);
+        getBestTwoNeighbours(g, mates, v, u, vGains, vNodes, vEdges);
+        int64_t bestGain = 0, bestUEdge = -1, bestVEdge = -1;
+        for (int64_t i = 0; i < 2; i++) {
+            if (uEdges[i] != -1 && uGains[i] - g->packedEdges[edge].weight > bestGain) { //Replace (u, v) with (a, u)
+                bestGain = uGains[i] - g->packedEdges[edge].weight;
+                bestUEdge = uEdges[i];
+                bestVEdge = -1;
+            }
+            if (vEdges[i] != -1 && vGains[i] - g->packedEdges[edge].weight > bestGain) { //Replace (u, v) with (v, b)
+                bestGain = vGains[i] - g->packedEdges[edge].weight;
+                bestUEdge = -1;
+                bestVEdge = vEdges[i];
+            }
+            for (int64_t j = 0; j < 2; j++) { //Replace (u, v) with (a, u) and (v, b)
+                if (uEdges[i] != -1 && vEdges[j] != -1 && uNodes[i] != vNodes[j]) {
+                    int64_t gain = uGains[i] + vGains[j] - g->packedEdges[edge].weight;
+                    int64_t aMate = mates[uNodes[i]];
+                    if (aMate != -1 && aMate == mates[vNodes[j]]) { //a and b are matched to each other, so only remove that edge once
+                        gain += g->packedEdges[aMate].weight;
+                    }
+                    if (gain > bestGain) {
+                        bestGain = gain;
+                        bestUEdge = uEdges[i];
+                        bestVEdge = vEdges[j];
+                    }
+                }
+            }
+        }
+        if (bestGain > 0) {
+            unmatch(g, mates, edge);
+            if (bestUEdge != -1) {
+                match(g, mates, bestUEdge);
+            }
+            if (bestVEdge != -1) {
+                match(g, mates, bestVEdge);
+            }
+            improved = 1;
+        }
+    }
+    return improved;
+}
+
+//The number of passes of short augmentations made, each linear in the number of edges, so that improving is linear.
+static const int64_t maximumAugmentationPasses = 3;
+
+stList *improveMatching_shortAugmentations(stList *edges, int64_t nodeNumber, stList *matching) {
+    matchingGraph *g = matchingGraph_construct(edges, nodeNumber);
+    int64_t *mates = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    for (int64_t n = 0; n < nodeNumber; n++) {
+        mates[n] = -1;
+    }
+    for (int64_t i = 0; i < stList_length(matching); i++) {
+        //Find the index of the matched edge among the edges incident with its first node
+        stIntTuple *edge = stList_get(matching, i);
+        int64_t node = stIntTuple_get(edge, 0), j = g->offsets[node];
+        while (j < g->offsets[node + 1] && stList_get(edges, g->incidentEdges[j]) != edge) {
+            j++;
+        }
+        assert(j < g->offsets[node + 1]); //The matching must be made of edges from the list
+        match(g, mates, g->incidentEdges[j]);
+    }
+    matchingGraph_makeMaximal(g, mates);
+    for (int64_t pass = 0; pass < maximumAugmentationPasses && improveMatesByShortAugmentations(g, mates); pass++) {
+        matchingGraph_makeMaximal(g, mates);
+    }
+    stList *improvedMatching = matchingGraph_getMatching(g, mates);
+    free(mates);
+    matchingGraph_destruct(g);
+    return improvedMatching;
+}
+
+stList *chooseMatching_pathGrowingWithAugmentations(stList *edges, int64_t nodeNumber) {
+    matchingGraph *g = matchingGraph_construct(edges, nodeNumber);
+    int64_t *mates = getPathGrowingMates(g);
+    for (int64_t pass = 0; pass < maximumAugmentationPasses && improveMatesByShortAugmentations(g, mates); pass++) {
+        matchingGraph_makeMaximal(g, mates);
+    }
+    stList *matching = matchingGraph_getMatching(g, mates);
+    free(mates);
+    matchingGraph_destruct(g);
+    return matching;
+}
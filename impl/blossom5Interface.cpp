@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * blossom5Interface.cpp
+ *
+ * Wraps the Blossom V PerfectMatching class behind the C interface in blossom5Interface.h.
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include "PerfectMatching.h"
+#include "blossom5Interface.h"
+
+struct _blossom5PerfectMatching {
+    PerfectMatching *pM;
+    int64_t nodeNumber;
+};
+
+blossom5PerfectMatching *blossom5PerfectMatching_construct(int64_t nodeNumber, int64_t edgeNumberMax) {
+    assert(nodeNumber >= 0 && nodeNumber <= INT_MAX);
+    assert(edgeNumberMax >= 0 && edgeNumberMax <= INT_MAX);
+    blossom5PerfectMatching *pM = new blossom5PerfectMatching;
+    pM->pM = new PerfectMatching((int) nodeNumber, (int) edgeNumberMax);
+    pM->pM->options.verbose = false; //Blossom V otherwise reports its progress to stdout
+    pM->nodeNumber = nodeNumber;
+    return pM;
+}
+
+void blossom5PerfectMatching_destruct(blossom5PerfectMatching *pM) {
+    delete pM->pM;
+    delete pM;
+}
+
+void blossom5PerfectMatching_setOptions(blossom5PerfectMatching *pM, int64_t fractionalJumpstart, int64_t dualGreedyUpdateOption,
+        double dualLPThreshold, int64_t updateDualsBefore, int64_t updateDualsAfter, double singleTreeThreshold) {
+    assert(dualGreedyUpdateOption >= 0 && dualGreedyUpdateOption <= 2);
+    assert(blossom5PerfectMatching_hasDoubleCosts() || (dualGreedyUpdateOption != 2 && dualLPThreshold <= 0.0));
+    pM->pM->options.fractional_jumpstart = fractionalJumpstart;
+    pM->pM->options.dual_greedy_update_option = (int) dualGreedyUpdateOption;
+    pM->pM->options.dual_LP_threshold = dualLPThreshold;
+    pM->pM->options.update_duals_before = updateDualsBefore;
+    pM->pM->options.update_duals_after = updateDualsAfter;
+    pM->pM->options.single_tree_threshold = singleTreeThreshold;
+}
+
+int64_t blossom5PerfectMatching_hasDoubleCosts(void) {
+#ifdef PERFECT_MATCHING_DOUBLE
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int64_t blossom5PerfectMatching_getMaximumCost(void) {
+#ifdef PERFECT_MATCHING_DOUBLE
+    return ((int64_t) 1) << 50; //Integers are exact in a double up to 2^53, leaving room for the sums of costs made by the solver.
+#else
+    return INT_MAX / 8; //The solver doubles costs and sums them, leaving room for this.
+#endif
+}
+
+int64_t blossom5PerfectMatching_addEdge(blossom5PerfectMatching *pM, int64_t node1, int64_t node2, int64_t cost) {
+    assert(node1 >= 0 && node1 < pM->nodeNumber);
+    assert(node2 >= 0 && node2 < pM->nodeNumber);
+    assert(node1 != node2);
+    assert(cost <= blossom5PerfectMatching_getMaximumCost() && -cost <= blossom5PerfectMatching_getMaximumCost());
+    return pM->pM->AddEdge((PerfectMatching::NodeId) node1, (PerfectMatching::NodeId) node2, (PerfectMatching::REAL) cost);
+}
+
+void blossom5PerfectMatching_solve(blossom5PerfectMatching *pM) {
+    pM->pM->Solve();
+}
+
+int64_t blossom5PerfectMatching_getSolution(blossom5PerfectMatching *pM, int64_t edge) {
+    assert(edge >= 0 && edge <= INT_MAX);
+    return pM->pM->GetSolution((PerfectMatching::EdgeId) edge);
+}
+
+int64_t blossom5PerfectMatching_getMatch(blossom5PerfectMatching *pM, int64_t node) {
+    assert(node >= 0 && node < pM->nodeNumber);
+    return pM->pM->GetMatch((PerfectMatching::NodeId) node);
+}
+
+void blossom5PerfectMatching_startUpdate(blossom5PerfectMatching *pM) {
+    pM->pM->StartUpdate();
+}
+
+void blossom5PerfectMatching_finishUpdate(blossom5PerfectMatching *pM) {
+    pM->pM->FinishUpdate();
+}
+
+int64_t blossom5PerfectMatching_addNewEdge(blossom5PerfectMatching *pM, int64_t node1, int64_t node2, int64_t cost) {
+    assert(node1 >= 0 && node1 < pM->nodeNumber);
+    assert(node2 >= 0 && node2 < pM->nodeNumber);
+    assert(node1 != node2);
+    assert(cost <= blossom5PerfectMatching_getMaximumCost() && -cost <= blossom5PerfectMatching_getMaximumCost());
+    //The edge is added even if it could not change the matching, so that its cost can be updated later.
+    return pM->pM->AddNewEdge((PerfectMatching::NodeId) node1, (PerfectMatching::NodeId) node2, (PerfectMatching::REAL) cost, false);
+}
+
+void blossom5PerfectMatching_updateCost(blossom5PerfectMatching *pM, int64_t edge, int64_t deltaCost) {
+    assert(edge >= 0 && edge <= INT_MAX);
+    pM->pM->UpdateCost((PerfectMatching::EdgeId) edge, (PerfectMatching::REAL) deltaCost);
+}
@@ -0,0 +1,91 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * blossom5Interface.h
+ *
+ * C interface to the Blossom V minimum cost perfect matching code in externalTools/blossom,
+ * which is compiled into the library so that matchings can be computed in process.
+ */
+
+#ifndef BLOSSOM5_INTERFACE_H_
+#define BLOSSOM5_INTERFACE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct _blossom5PerfectMatching blossom5PerfectMatching;
+
+/*
+ * Creates an empty problem with nodes 0, ..., nodeNumber-1 and room for at most edgeNumberMax edges.
+ */
+blossom5PerfectMatching *blossom5PerfectMatching_construct(int64_t nodeNumber, int64_t edgeNumberMax);
+
+void blossom5PerfectMatching_destruct(blossom5PerfectMatching *pM);
+
+/*
+ * Sets the options of the solver, as described for PerfectMatching::Options. Must be called before solving.
+ * A dualGreedyUpdateOption of 2 or a dualLPThreshold greater than zero need costs to be doubles.
+ */
+void blossom5PerfectMatching_setOptions(blossom5PerfectMatching *pM, int64_t fractionalJumpstart, int64_t dualGreedyUpdateOption,
+        double dualLPThreshold, int64_t updateDualsBefore, int64_t updateDualsAfter, double singleTreeThreshold);
+
+/*
+ * Returns non-zero if the solver was compiled with PERFECT_MATCHING_DOUBLE, so that costs are doubles rather than ints.
+ */
+int64_t blossom5PerfectMatching_hasDoubleCosts(void);
+
+/*
+ * Returns the largest magnitude of cost that can be given to an edge without risking overflow, or loss of precision, within the solver.
+ */
+int64_t blossom5PerfectMatching_getMaximumCost(void);
+
+/*
+ * Adds an edge, returning its index. The magnitude of the cost must be at most blossom5PerfectMatching_getMaximumCost(). The first edge added has index 0, the second 1, and so on.
+ */
+int64_t blossom5PerfectMatching_addEdge(blossom5PerfectMatching *pM, int64_t node1, int64_t node2, int64_t cost);
+
+/*
+ * Computes a minimum cost perfect matching. A perfect matching must exist.
+ */
+void blossom5PerfectMatching_solve(blossom5PerfectMatching *pM);
+
+/*
+ * Returns non-zero if the edge with the given index is in the matching, after solving.
+ */
+int64_t blossom5PerfectMatching_getSolution(blossom5PerfectMatching *pM, int64_t edge);
+
+/*
+ * Gets the node matched to the given node, after solving.
+ */
+int64_t blossom5PerfectMatching_getMatch(blossom5PerfectMatching *pM, int64_t node);
+
+/*
+ * After solving, edges can be added and their costs changed between a call to startUpdate and a call to finishUpdate.
+ * Solving again then starts from the previous solution.
+ */
+void blossom5PerfectMatching_startUpdate(blossom5PerfectMatching *pM);
+
+void blossom5PerfectMatching_finishUpdate(blossom5PerfectMatching *pM);
+
+/*
+ * Adds an edge while updating, returning its index, which follows those of the edges already added.
+ */
+int64_t blossom5PerfectMatching_addNewEdge(blossom5PerfectMatching *pM, int64_t node1, int64_t node2, int64_t cost);
+
+/*
+ * Adds deltaCost to the cost of the edge with the given index while updating.
+ */
+void blossom5PerfectMatching_updateCost(blossom5PerfectMatching *pM, int64_t edge, int64_t deltaCost);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* BLOSSOM5_INTERFACE_H_ */
@@ -1,58 +1,174 @@
+#include <stdlib.h>
 #include "sonLib.h"
 #include "shared.h"
+#include "stCheckEdges.h"
 
-void checkEdges(stList *edges, stSortedSet * nodes, bool coversAllNodes,
+#ifdef NDEBUG
+static edgeValidationLevel validationLevel = EDGE_VALIDATION_OFF;
+#else
+static edgeValidationLevel validationLevel = EDGE_VALIDATION_FULL;
+#endif
+
+void setEdgeValidationLevel(edgeValidationLevel level) {
+    validationLevel = level;
+}
+
+edgeValidationLevel getEdgeValidationLevel(void) {
+    return validationLevel;
+}
+
+void checkEdgesCondition(bool condition, const char *message) {
+    if (!condition) {
+        st_errAbort("Invalid edges: %s", message);
+    }
+}
+
+static const char *getEdgesErrorFull(stList *edges, stSortedSet * nodes, bool coversAllNodes,
         bool isClique) {
     int64_t nodeNumber = stSortedSet_size(nodes);
     int64_t maxNode = nodeNumber == 0 ? 0 : stIntTuple_get(stSortedSet_getLast(nodes), 0);
-    (void)maxNode;
+    const char *error = NULL;
     stSortedSet *edgesSeen = stSortedSet_construct3(
             (int(*)(const void *, const void *)) stIntTuple_cmpFn,
             (void(*)(void *)) stIntTuple_destruct);
-    for (int64_t i = 0; i < stList_length(edges); i++) {
+    for (int64_t i = 0; i < stList_length(edges) && error == NULL; i++) {
         stIntTuple *edge = stList_get(edges, i);
+        if (stIntTuple_length(edge) != 2 && stIntTuple_length(edge) != 3) {
+            error = "an edge has the wrong length";
+        }
         /*
          * Check edges connect actual nodes.
          */
-        assert(stIntTuple_get(edge, 0) >= 0);
-        assert(stIntTuple_get(edge, 0) <= maxNode);
-        assert(stIntTuple_get(edge, 1) >= 0);
-        assert(stIntTuple_get(edge, 1) <= maxNode);
-        assert(
-                stIntTuple_get(edge, 1) != stIntTuple_get(edge,
-                        0)); //No self edges!
+        else if (stIntTuple_get(edge, 0) < 0 || stIntTuple_get(edge, 0) > maxNode
+                || stIntTuple_get(edge, 1) < 0 || stIntTuple_get(edge, 1) > maxNode) {
+            error = "an edge has a node out of range";
+        }
+        else if (stIntTuple_get(edge, 1) == stIntTuple_get(edge, 0)) { //No self edges!
+            error = "an edge is a self edge";
+        }
         /*
          * Check is not a multi-graph.
          */
-        assert(
-                !edgeInSet(edgesSeen, stIntTuple_get(edge, 0),
-                        stIntTuple_get(edge, 1)));
-        addEdgeToSet(edgesSeen, stIntTuple_get(edge, 0),
-                stIntTuple_get(edge, 1));
+        else if (edgeInSet(edgesSeen, stIntTuple_get(edge, 0), stIntTuple_get(edge, 1))) {
+            error = "two edges join the same nodes";
+        }
         /*
          * Check weight, if  weighted.
          */
-        if (stIntTuple_length(edge) == 3) {
-            assert(stIntTuple_get(edge, 2) >= 0);
-        } else {
-            assert(stIntTuple_length(edge) == 2);
+        else if (stIntTuple_length(edge) == 3 && stIntTuple_get(edge, 2) < 0) {
+            error = "an edge has a negative weight";
+        }
+        else {
+            addEdgeToSet(edgesSeen, stIntTuple_get(edge, 0),
+                    stIntTuple_get(edge, 1));
         }
     }
     stSortedSet_destruct(edgesSeen);
     /*
      * Check edges connect all nodes.
      */
-    if (coversAllNodes) {
+    if (error == NULL && coversAllNodes) {
         stSortedSet *nodes = getNodeSetOfEdges(edges);
-        assert(stSortedSet_size(nodes) == nodeNumber);
+        if (stSortedSet_size(nodes) != nodeNumber) {
+            error = "the edges do not cover all the nodes";
+        }
         stSortedSet_destruct(nodes);
     }
     /*
      * Check is clique.
      */
-    if (isClique) {
-        assert(
-                stList_length(edges) == (nodeNumber * nodeNumber - nodeNumber)
-                        / 2);
+    if (error == NULL && isClique && stList_length(edges) != (nodeNumber * nodeNumber - nodeNumber) / 2) {
+        error = "the edges are not a clique";
     }
+    return error;
+}
+
+static int comparePackedEdges(const void *a, const void *b) {
+    const packedEdge *edge1 = a, *edge2 = b;
+    if (edge1->node1 != edge2->node1) {
+        return edge1->node1 < edge2->node1 ? -1 : 1;
+    }
+    return edge1->node2 < edge2->node2 ? -1 : (edge1->node2 > edge2->node2 ? 1 : 0);
+}
+
+static const char *getEdgesErrorFast(stList *edges, stSortedSet * nodes, bool coversAllNodes,
+        bool isClique) {
+    /*
+     * Makes the checks of getEdgesErrorFull using a sorted array of the packed edges to find multi-edges, and
+     * a sorted array of their nodes to check they cover the nodes, so uses memory proportional to the number of edges.
+     */
+    int64_t nodeNumber = stSortedSet_size(nodes);
+    int64_t maxNode = nodeNumber == 0 ? 0 : stIntTuple_get(stSortedSet_getLast(nodes), 0);
+    int64_t edgeNumber = stList_length(edges);
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        int64_t length = stIntTuple_length(stList_get(edges, i));
+        if (length != 2 && length != 3) {
+            return "an edge has the wrong length";
+        }
+    }
+    const char *error = NULL;
+    packedEdge *packedEdges = getPackedEdges(edges);
+    for (int64_t i = 0; i < edgeNumber && error == NULL; i++) {
+        packedEdge *edge = &packedEdges[i];
+        if (edge->node1 < 0 || edge->node1 > maxNode || edge->node2 < 0 || edge->node2 > maxNode) {
+            error = "an edge has a node out of range";
+        } else if (edge->node1 == edge->node2) {
+            error = "an edge is a self edge";
+        } else if (edge->weight < 0) {
+            error = "an edge has a negative weight";
+        } else if (edge->node1 > edge->node2) {
+            int64_t node = edge->node1;
+            edge->node1 = edge->node2;
+            edge->node2 = node;
+        }
+    }
+    if (error == NULL) {
+        qsort(packedEdges, edgeNumber, sizeof(packedEdge), comparePackedEdges);
+        for (int64_t i = 1; i < edgeNumber && error == NULL; i++) {
+            if (comparePackedEdges(&packedEdges[i - 1], &packedEdges[i]) == 0) {
+                error = "two edges join the same nodes";
+            }
+        }
+    }
+    free(packedEdges);
+    if (error == NULL && coversAllNodes) {
+        //Walk the distinct nodes of the edges and the nodes together, in order.
+        int64_t edgeNodeNumber;
+        int64_t *edgeNodes = getDistinctNodesOfEdges(edges, &edgeNodeNumber);
+        int64_t coveredNumber = 0, i = 0;
+        stSortedSetIterator *it = stSortedSet_getIterator(nodes);
+        stIntTuple *node;
+        while ((node = stSortedSet_getNext(it)) != NULL) {
+            while (i < edgeNodeNumber && edgeNodes[i] < stIntTuple_get(node, 0)) {
+                i++;
+            }
+            coveredNumber += i < edgeNodeNumber && edgeNodes[i] == stIntTuple_get(node, 0) ? 1 : 0;
+        }
+        stSortedSet_destructIterator(it);
+        free(edgeNodes);
+        if (coveredNumber != nodeNumber) {
+            error = "the edges do not cover all the nodes";
+        }
+    }
+    if (error == NULL && isClique && edgeNumber != (nodeNumber * nodeNumber - nodeNumber) / 2) {
+        error = "the edges are not a clique";
+    }
+    return error;
+}
+
+const char *getEdgesError(stList *edges, stSortedSet * nodes, bool coversAllNodes,
+        bool isClique, edgeValidationLevel level) {
+    if (level == EDGE_VALIDATION_FULL) {
+        return getEdgesErrorFull(edges, nodes, coversAllNodes, isClique);
+    }
+    if (level == EDGE_VALIDATION_FAST) {
+        return getEdgesErrorFast(edges, nodes, coversAllNodes, isClique);
+    }
+    return NULL;
+}
+
+void checkEdges(stList *edges, stSortedSet * nodes, bool coversAllNodes,
+        bool isClique) {
+    const char *error = getEdgesError(edges, nodes, coversAllNodes, isClique, validationLevel);
+    checkEdgesCondition(error == NULL, error);
 }
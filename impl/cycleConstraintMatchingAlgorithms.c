@@ -1,7 +1,10 @@
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include "sonLib.h"
 #include "stCheckEdges.h"
 #include "stPerfectMatching.h"
+#include "stCycleConstrainedMatchingAlgorithms.h"
 #include "shared.h"
 #include "stMatchingAlgorithms.h"
 
@@ -11,19 +14,6 @@
 ////////////////////////////////////
 ////////////////////////////////////
 
-static int64_t intersectionSize(stSortedSet *set, stList *list) {
-    /*
-     * Returns the intersection size of the list and the set.
-     */
-    int64_t count = 0;
-    for (int64_t j = 0; j < stList_length(list); j++) {
-        if (stSortedSet_search(set, stList_get(list, j)) != NULL) {
-            count++;
-        }
-    }
-    return count;
-}
-
 static stList *filterListsToExclude(stList *listOfLists, stSortedSet *set) {
     /*
      * Takes a list of lists and returns a new list of lists whose elements are the product of applying
@@ -61,34 +51,184 @@ stList *getStubAndChainEdgeFreeComponents(stList *listOfLists, stList *list1,
     return filteredListOfLists;
 }
 
+////////////////////////////////////
+////////////////////////////////////
+//Lists of packed edges
+////////////////////////////////////
+////////////////////////////////////
+
+typedef struct _edgeList {
+    /*
+     * A growable array of packed edges. The index of each edge is the position of its tuple in the table of the tuple
+     * edges of the problem, or -1 for a zero weight edge made by the algorithms, so tuples are only looked up, or made,
+     * once the matching is done.
+     */
+    int64_t length;
+    int64_t maxLength;
+    packedEdge *edges;
+} edgeList;
+
+static edgeList *edgeList_construct(int64_t maxLength) {
+    edgeList *eL = st_malloc(sizeof(edgeList));
+    eL->length = 0;
+    eL->maxLength = maxLength > 0 ? maxLength : 1;
+    eL->edges = st_malloc(sizeof(packedEdge) * eL->maxLength);
+    return eL;
+}
+
+static void edgeList_destruct(edgeList *eL) {
+    free(eL->edges);
+    free(eL);
+}
+
+static void edgeList_append(edgeList *eL, const packedEdge *edge) {
+    if (eL->length == eL->maxLength) {
+        eL->maxLength *= 2;
+        eL->edges = st_realloc(eL->edges, sizeof(packedEdge) * eL->maxLength);
+    }
+    eL->edges[eL->length++] = *edge;
+}
+
+static void edgeList_appendAll(edgeList *eL, edgeList *eL2) {
+    for (int64_t i = 0; i < eL2->length; i++) {
+        edgeList_append(eL, &eL2->edges[i]);
+    }
+}
+
+static edgeList *edgeList_copy(edgeList *eL) {
+    edgeList *eL2 = edgeList_construct(eL->length);
+    edgeList_appendAll(eL2, eL);
+    return eL2;
+}
+
+static bool packedEdge_equals(const packedEdge *edge1, const packedEdge *edge2) {
+    return edge1->index == edge2->index && edge1->node1 == edge2->node1 && edge1->node2 == edge2->node2;
+}
+
+static edgeList *addToEdgeTable(stList *table, stList *edges) {
+    /*
+     * Appends the tuple edges to the table, returning them packed, each indexed by its position in the table.
+     */
+    edgeList *eL = st_malloc(sizeof(edgeList));
+    eL->edges = getPackedEdges2(edges, stList_length(table), 0, &eL->length);
+    eL->maxLength = stList_length(edges) + 1;
+    stList_appendAll(table, edges);
+    return eL;
+}
+
+static stList *getTupleEdges(edgeList *edges, stList *table, stList *zeroWeightEdges) {
+    /*
+     * Returns the tuple edges of the packed edges, in the same order. Each edge made by the algorithms is created as a
+     * zero weight tuple and appended to zeroWeightEdges, which may only be NULL if there are none.
+     */
+    stList *tupleEdges = stList_construct2(edges->length);
+    for (int64_t i = 0; i < edges->length; i++) {
+        packedEdge *edge = &edges->edges[i];
+        stIntTuple *tupleEdge;
+        if (edge->index == -1) {
+            assert(zeroWeightEdges != NULL); //Otherwise the adjacency edges are a clique.
+            tupleEdge = constructWeightedEdge(edge->node1, edge->node2, 0);
+            stList_append(zeroWeightEdges, tupleEdge);
+        } else {
+            tupleEdge = stList_get(table, edge->index);
+        }
+        stList_set(tupleEdges, i, tupleEdge);
+    }
+    return tupleEdges;
+}
+
+static void logMatching(const char *step, edgeList *matching) {
+    int64_t cardinality = 0, weight = 0;
+    for (int64_t i = 0; i < matching->length; i++) {
+        cardinality += matching->edges[i].weight > 0 ? 1 : 0;
+        weight += matching->edges[i].weight;
+    }
+    st_logDebug(
+            "%s the matching has %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
+            step, matching->length, cardinality, weight);
+}
+
 ////////////////////////////////////
 ////////////////////////////////////
 //Functions to compute connected components.
 ////////////////////////////////////
 ////////////////////////////////////
 
-static void getComponentsP(stHash *nodesToEdges, int64_t node,
-        stSortedSet *component) {
-    stIntTuple *key = stIntTuple_construct1( node);
-    stList *edges = stHash_search(nodesToEdges, key);
-    if (edges != NULL) {
-        stHash_remove(nodesToEdges, key);
-        for (int64_t i = 0; i < stList_length(edges); i++) {
-            stIntTuple *edge = stList_get(edges, i);
-            if (stSortedSet_search(component, edge) == NULL) {
-                stSortedSet_insert(component, edge);
+typedef struct _edgeComponents {
+    /*
+     * The connected components of an array of edges. The edges of component i are those whose indices in the array are
+     * edgeIndices[offsets[i]] to edgeIndices[offsets[i+1]-1].
+     */
+    int64_t componentNumber;
+    int64_t *offsets;
+    int64_t *edgeIndices;
+} edgeComponents;
+
+static edgeComponents *edgeComponents_construct(packedEdge *edges, int64_t edgeNumber) {
+    /*
+     * Labels the components with a union-find over the nodes of the edges, so uses no recursion. Components are numbered in
+     * the order of their first edge in the array, and the edges of each component are in the order of the array.
+     */
+    //Number the distinct nodes.
+    int64_t nodeNumber;
+    int64_t *nodes = getDistinctNodesOfPackedEdges(edges, edgeNumber, &nodeNumber);
+    int64_t *firstNodes = st_malloc(sizeof(int64_t) * (edgeNumber + 1)); //The index of the first node of each edge.
+    int64_t *parents = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    int64_t *sizes = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        parents[i] = i;
+        sizes[i] = 1;
+    }
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        firstNodes[i] = getNodeIndex(nodes, nodeNumber, edges[i].node1);
+        int64_t root1 = findRoot(parents, firstNodes[i]);
+        int64_t root2 = findRoot(parents, getNodeIndex(nodes, nodeNumber, edges[i].node2));
+        if (root1 != root2) { //Union by size.
+            if (sizes[root1] < sizes[root2]) {
+                int64_t j = root1;
+                root1 = root2;
+                root2 = j;
             }
-            /*
-             * Recursion on stack could equal the total number of nodes.
-             */
-            getComponentsP(nodesToEdges, stIntTuple_get(edge, 0),
-                    component);
-            getComponentsP(nodesToEdges, stIntTuple_get(edge, 1),
-                    component);
+            parents[root2] = root1;
+            sizes[root1] += sizes[root2];
         }
-        stList_destruct(edges);
     }
-    stIntTuple_destruct(key);
+    //Number the components and count their edges, reusing the sizes array for the component number of each root.
+    edgeComponents *eC = st_malloc(sizeof(edgeComponents));
+    eC->componentNumber = 0;
+    eC->offsets = st_calloc(edgeNumber + 2, sizeof(int64_t));
+    eC->edgeIndices = st_malloc(sizeof(int64_t) * (edgeNumber + 1));
+    int64_t *components = sizes;
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        components[i] = -1;
+    }
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        int64_t root = findRoot(parents, firstNodes[i]);
+        if (components[root] == -1) {
+            components[root] = eC->componentNumber++;
+        }
+        firstNodes[i] = components[root]; //From here on the component of each edge.
+        eC->offsets[firstNodes[i] + 1]++;
+    }
+    for (int64_t i = 0; i < eC->componentNumber; i++) {
+        eC->offsets[i + 1] += eC->offsets[i];
+    }
+    int64_t *fill = parents; //The next free position of each component, reusing the parents array.
+    memcpy(fill, eC->offsets, sizeof(int64_t) * eC->componentNumber);
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        eC->edgeIndices[fill[firstNodes[i]]++] = i;
+    }
+    free(nodes);
+    free(firstNodes);
+    free(parents);
+    free(sizes);
+    return eC;
+}
+
+static void edgeComponents_destruct(edgeComponents *eC) {
+    free(eC->offsets);
+    free(eC->edgeIndices);
+    free(eC);
 }
 
 stList *getComponents(stList *edges) {
@@ -97,38 +237,19 @@ stList *getComponents(stList *edges) {
      * being represented as a list of the edges, such that each edge is in exactly one
      * connected component. Allows for multi-graphs (multiple edges connecting two nodes).
      */
-
-    stHash *nodesToEdges = getNodesToEdgesHash(edges);
-
-    /*
-     * Traverse the edges greedily
-     */
+    packedEdge *packedEdges = getPackedEdges(edges);
+    edgeComponents *eC = edgeComponents_construct(packedEdges, stList_length(edges));
     stList *components =
-            stList_construct3(0, (void(*)(void *)) stList_destruct);
-    stList *nodes = stHash_getKeys(nodesToEdges);
-    while (stList_length(nodes) > 0) {
-        stIntTuple *node = stList_pop(nodes);
-        stList *edges = stHash_search(nodesToEdges, node);
-        if (edges != NULL) { //We have a component to build
-            stSortedSet *component = stSortedSet_construct();
-            stHash_remove(nodesToEdges, node);
-            for (int64_t i = 0; i < stList_length(edges); i++) {
-                stIntTuple *edge = stList_get(edges, i);
-                getComponentsP(nodesToEdges, stIntTuple_get(edge, 0),
-                        component);
-                getComponentsP(nodesToEdges, stIntTuple_get(edge, 1),
-                        component);
-            }
-            stList_append(components, stSortedSet_getList(component));
-            //Cleanup
-            stSortedSet_destruct(component);
-            stList_destruct(edges);
+            stList_construct3(eC->componentNumber, (void(*)(void *)) stList_destruct);
+    for (int64_t i = 0; i < eC->componentNumber; i++) {
+        stList *component = stList_construct2(eC->offsets[i + 1] - eC->offsets[i]);
+        for (int64_t j = eC->offsets[i]; j < eC->offsets[i + 1]; j++) {
+            stList_set(component, j - eC->offsets[i], stList_get(edges, eC->edgeIndices[j]));
         }
-        stIntTuple_destruct(node);
+        stList_set(components, i, component);
     }
-    assert(stHash_size(nodesToEdges) == 0);
-    stHash_destruct(nodesToEdges);
-    stList_destruct(nodes);
+    edgeComponents_destruct(eC);
+    free(packedEdges);
 
     return components;
 }
@@ -154,371 +275,661 @@ stList *getComponents2(stList *adjacencyEdges, stList *stubEdges,
     return components;
 }
 
+static stList *getEdgeListComponents(edgeList *adjacencyEdges, edgeList *stubEdges,
+        edgeList *chainEdges) {
+    /*
+     * As getComponents2, for lists of packed edges, returning a list of the lists of the edges of each component.
+     */
+    edgeList *allEdges = edgeList_construct(0);
+    if (adjacencyEdges != NULL) {
+        edgeList_appendAll(allEdges, adjacencyEdges);
+    }
+    if (stubEdges != NULL) {
+        edgeList_appendAll(allEdges, stubEdges);
+    }
+    if (chainEdges != NULL) {
+        edgeList_appendAll(allEdges, chainEdges);
+    }
+    edgeComponents *eC = edgeComponents_construct(allEdges->edges, allEdges->length);
+    stList *components =
+            stList_construct3(eC->componentNumber, (void(*)(void *)) edgeList_destruct);
+    for (int64_t i = 0; i < eC->componentNumber; i++) {
+        edgeList *component = edgeList_construct(eC->offsets[i + 1] - eC->offsets[i]);
+        for (int64_t j = eC->offsets[i]; j < eC->offsets[i + 1]; j++) {
+            edgeList_append(component, &allEdges->edges[eC->edgeIndices[j]]);
+        }
+        stList_set(components, i, component);
+    }
+    edgeComponents_destruct(eC);
+    edgeList_destruct(allEdges);
+    return components;
+}
+
 ////////////////////////////////////
 ////////////////////////////////////
-//Functions to compute adjacency edge switches between cycles
+//Functions to classify edges by type
 ////////////////////////////////////
 ////////////////////////////////////
 
-typedef struct _AdjacencySwitch {
+typedef enum _edgeType {
+    ADJACENCY_EDGE, STUB_EDGE, CHAIN_EDGE
+} edgeType;
+
+typedef struct _edgeClassification {
     /*
-     * Structure  to represent an adjacency edge switch, in which two edges are removed and replaced with two others.
+     * The edges of a problem, classified once so that the edges of cycles can be filtered by type without building
+     * sets of the stub and chain edges. The stub and chain edges come last in the table of tuple edges, so the type of
+     * an edge follows from its index: from firstStubEdge are stub edges, from firstChainEdge chain edges, and any other
+     * edge, including those made by the algorithms, is an adjacency edge. Nodes are numbered by their position in a
+     * sorted array of the nodes of the stub and chain edges. Once indexed, the non-zero weight adjacency edges of node i
+     * are those at indices adjacencyEdgeIndices[adjacencyOffsets[i]] to adjacencyEdgeIndices[adjacencyOffsets[i+1]-1]
+     * of adjacencyEdges.
      */
-    stIntTuple *oldEdge1;
-    stIntTuple *oldEdge2;
-    stIntTuple *newEdge1;
-    stIntTuple *newEdge2;
-    int64_t cost;
-} AdjacencySwitch;
-
-static AdjacencySwitch *adjacencySwitch_construct(stIntTuple *oldEdge1,
-        stIntTuple *oldEdge2, stIntTuple *newEdge1, stIntTuple *newEdge2,
-        int64_t cost) {
-    AdjacencySwitch *adjacencySwitch = st_malloc(sizeof(AdjacencySwitch));
-    adjacencySwitch->oldEdge1 = oldEdge1;
-    adjacencySwitch->oldEdge2 = oldEdge2;
-    adjacencySwitch->newEdge1 = newEdge1;
-    adjacencySwitch->newEdge2 = newEdge2;
-    assert(oldEdge1 != NULL);
-    assert(oldEdge2 != NULL);
-    assert(newEdge1 != NULL);
-    assert(newEdge2 != NULL);
-    adjacencySwitch->cost = cost;
-    return adjacencySwitch;
-}
-
-static void adjacencySwitch_destruct(AdjacencySwitch *adjacencySwitch) {
-    free(adjacencySwitch);
-}
-
-static AdjacencySwitch *adjacencySwitch_update(
-        AdjacencySwitch *adjacencySwitch, stIntTuple *oldEdge1,
-        stIntTuple *oldEdge2, stIntTuple *newEdge1, stIntTuple *newEdge2,
-        int64_t cost) {
-    /*
-     * Convenience function, replaces one adjacency edge with a new one if the cost is lower.
-     */
-    if (adjacencySwitch == NULL) {
-        return adjacencySwitch_construct(oldEdge1, oldEdge2, newEdge1,
-                newEdge2, cost);
-    }
-    if (adjacencySwitch->cost > cost) {
-        adjacencySwitch_destruct(adjacencySwitch);
-        return adjacencySwitch_construct(oldEdge1, oldEdge2, newEdge1,
-                newEdge2, cost);
-    }
-    return adjacencySwitch;
-}
-
-static AdjacencySwitch *getBest4EdgeAdjacencySwitchP(stIntTuple *oldEdge1,
-        int64_t node1, stSortedSet *allAdjacencyEdges,
-        stHash *nodesToAllCurrentEdges, stHash *nodesToBridgingAdjacencyEdges) {
-    /*
-     * Returns the best adjacency switch for the given node and edge that
-     * contains 4 existing edges.
-     */
-    int64_t node4 = getOtherPosition(oldEdge1, node1);
-    AdjacencySwitch *minimumCostAdjacencySwitch = NULL;
-    stList *validEdges = getItemForNode(node1, nodesToBridgingAdjacencyEdges);
-    if (validEdges != NULL) {
-        for (int64_t i = 0; i < stList_length(validEdges); i++) {
-            stIntTuple *newEdge1 = stList_get(validEdges, i);
-            int64_t node2 = getOtherPosition(newEdge1, node1);
-            stList *validEdges2 =
-                    getItemForNode(node2, nodesToAllCurrentEdges);
-            assert(validEdges2 != NULL);
-            assert(stList_length(validEdges2) == 1);
-            stIntTuple *oldEdge2 = stList_peek(validEdges2);
-            int64_t node3 = getOtherPosition(oldEdge2, node2);
-            stIntTuple *newEdge2 = getWeightedEdgeFromSet(node3, node4,
-                    allAdjacencyEdges);
-            assert(newEdge2 != NULL);
-            int64_t cost = stIntTuple_get(oldEdge1, 2)
-                    + stIntTuple_get(oldEdge2, 2)
-                    - stIntTuple_get(newEdge1, 2)
-                    - stIntTuple_get(newEdge2, 2);
-            minimumCostAdjacencySwitch = adjacencySwitch_update(
-                    minimumCostAdjacencySwitch, oldEdge1, oldEdge2, newEdge1,
-                    newEdge2, cost);
-        }
+    int64_t firstStubEdge;
+    int64_t firstChainEdge;
+    int64_t nodeNumber;
+    int64_t *nodes;
+    edgeList *adjacencyEdges;
+    int64_t *adjacencyOffsets;
+    int64_t *adjacencyEdgeIndices;
+} edgeClassification;
+
+static edgeClassification *edgeClassification_construct(edgeList *stubEdges, edgeList *chainEdges,
+        int64_t firstStubEdge, int64_t firstChainEdge) {
+    edgeClassification *eC = st_malloc(sizeof(edgeClassification));
+    eC->firstStubEdge = firstStubEdge;
+    eC->firstChainEdge = firstChainEdge;
+    int64_t stubOrChainEdgeNumber = stubEdges->length + chainEdges->length;
+    eC->nodes = st_malloc(sizeof(int64_t) * (2 * stubOrChainEdgeNumber + 1));
+    for (int64_t i = 0; i < stubOrChainEdgeNumber; i++) {
+        packedEdge *edge = i < stubEdges->length ? &stubEdges->edges[i] : &chainEdges->edges[i - stubEdges->length];
+        assert(edge->index >= (i < stubEdges->length ? firstStubEdge : firstChainEdge));
+        eC->nodes[2 * i] = edge->node1;
+        eC->nodes[2 * i + 1] = edge->node2;
     }
-    return minimumCostAdjacencySwitch;
+    eC->nodeNumber = sortDistinctNodes(eC->nodes, 2 * stubOrChainEdgeNumber);
+    assert(eC->nodeNumber == 2 * stubOrChainEdgeNumber); //Each node has exactly one stub or chain edge.
+    eC->adjacencyEdges = NULL;
+    eC->adjacencyOffsets = NULL;
+    eC->adjacencyEdgeIndices = NULL;
+    return eC;
 }
 
-static AdjacencySwitch *getMinimumCostAdjacencySwitch(
-        AdjacencySwitch *adjacencySwitch1, AdjacencySwitch *adjacencySwitch2) {
+static void edgeClassification_indexAdjacencyEdges(edgeClassification *eC, edgeList *nonZeroWeightAdjacencyEdges) {
     /*
-     * Convenience function that returns the adjacency switch of the two with lower cost,
-     * allowing for NULL values and destroying
-     * the higher cost adjacency switch in the process.
+     * Indexes the non-zero weight adjacency edges by node, replacing any previous index.
      */
-    if (adjacencySwitch1 == NULL) {
-        return adjacencySwitch2;
+    free(eC->adjacencyOffsets);
+    free(eC->adjacencyEdgeIndices);
+    eC->adjacencyEdges = nonZeroWeightAdjacencyEdges;
+    int64_t adjacencyEdgeNumber = nonZeroWeightAdjacencyEdges->length;
+    eC->adjacencyOffsets = st_calloc(eC->nodeNumber + 1, sizeof(int64_t));
+    for (int64_t i = 0; i < adjacencyEdgeNumber; i++) {
+        packedEdge *edge = &nonZeroWeightAdjacencyEdges->edges[i];
+        eC->adjacencyOffsets[getNodeIndex(eC->nodes, eC->nodeNumber, edge->node1) + 1]++;
+        eC->adjacencyOffsets[getNodeIndex(eC->nodes, eC->nodeNumber, edge->node2) + 1]++;
     }
-    if (adjacencySwitch2 == NULL) {
-        return adjacencySwitch1;
+    for (int64_t i = 0; i < eC->nodeNumber; i++) {
+        eC->adjacencyOffsets[i + 1] += eC->adjacencyOffsets[i];
     }
-    if (adjacencySwitch1->cost < adjacencySwitch2->cost) {
-        adjacencySwitch_destruct(adjacencySwitch2);
-        return adjacencySwitch1;
+    eC->adjacencyEdgeIndices = st_malloc(sizeof(int64_t) * (2 * adjacencyEdgeNumber + 1));
+    int64_t *positions = st_malloc(sizeof(int64_t) * (eC->nodeNumber + 1));
+    memcpy(positions, eC->adjacencyOffsets, sizeof(int64_t) * (eC->nodeNumber + 1));
+    for (int64_t i = 0; i < adjacencyEdgeNumber; i++) {
+        packedEdge *edge = &nonZeroWeightAdjacencyEdges->edges[i];
+        eC->adjacencyEdgeIndices[positions[getNodeIndex(eC->nodes, eC->nodeNumber, edge->node1)]++] = i;
+        eC->adjacencyEdgeIndices[positions[getNodeIndex(eC->nodes, eC->nodeNumber, edge->node2)]++] = i;
     }
-    adjacencySwitch_destruct(adjacencySwitch1);
-    return adjacencySwitch2;
+    free(positions);
 }
 
-static AdjacencySwitch *getBest4EdgeAdjacencySwitch2(stIntTuple *oldEdge1,
-        stSortedSet *allAdjacencyEdges, stHash *nodesToAllCurrentEdgesSet,
-        stHash *nodesToBridgingAdjacencyEdges) {
-    /*
-     * Returns the best 3 or 4 edge switch (one including 3 or 4 edges) for the given existing edge, if they exist, or else NULL.
-     */
-    return getMinimumCostAdjacencySwitch(
-            getBest4EdgeAdjacencySwitchP(oldEdge1,
-                    stIntTuple_get(oldEdge1, 0), allAdjacencyEdges,
-                    nodesToAllCurrentEdgesSet, nodesToBridgingAdjacencyEdges),
-            getBest4EdgeAdjacencySwitchP(oldEdge1,
-                    stIntTuple_get(oldEdge1, 1), allAdjacencyEdges,
-                    nodesToAllCurrentEdgesSet, nodesToBridgingAdjacencyEdges));
+static void edgeClassification_destruct(edgeClassification *eC) {
+    free(eC->nodes);
+    free(eC->adjacencyOffsets);
+    free(eC->adjacencyEdgeIndices);
+    free(eC);
 }
 
-static stList *getEdgesThatBridgeComponents(stList *components,
-        stHash *nodesToNonZeroWeightedAdjacencyEdges) {
-    /*
-     * Get set of adjacency edges that bridge between (have a node in two) components.
-     */
-
-    stList *bridgingAdjacencyEdges = stList_construct();
+static edgeType edgeClassification_getType(edgeClassification *eC, const packedEdge *edge) {
+    return edge->index >= eC->firstChainEdge ? CHAIN_EDGE : (edge->index >= eC->firstStubEdge ? STUB_EDGE : ADJACENCY_EDGE);
+}
 
-    for (int64_t i = 0; i < stList_length(components); i++) {
-        stSortedSet *componentNodes = getNodeSetOfEdges(
-                stList_get(components, i));
-        stSortedSetIterator *it = stSortedSet_getIterator(componentNodes);
-        stIntTuple *node;
-        while ((node = stSortedSet_getNext(it)) != NULL) {
-            stList *edges = stHash_search(nodesToNonZeroWeightedAdjacencyEdges,
-                    node);
-            if (edges != NULL) {
-                for (int64_t j = 0; j < stList_length(edges); j++) {
-                    stIntTuple *edge = stList_get(edges, j);
-                    stIntTuple *node1 = stIntTuple_construct1(
-                            stIntTuple_get(edge, 0));
-                    stIntTuple *node2 = stIntTuple_construct1(
-                            stIntTuple_get(edge, 1));
-                    assert(
-                            stSortedSet_search(componentNodes, node1) != NULL
-                                    || stSortedSet_search(componentNodes, node2)
-                                            != NULL);
-                    if (stSortedSet_search(componentNodes, node1) == NULL
-                            || stSortedSet_search(componentNodes, node2)
-                                    == NULL) {
-                        stList_append(bridgingAdjacencyEdges, edge);
-                    }
-                    stIntTuple_destruct(node1);
-                    stIntTuple_destruct(node2);
-                }
-            }
+static int64_t getEdgeNumberOfType(edgeClassification *eC, edgeList *edges, edgeType type) {
+    int64_t count = 0;
+    for (int64_t i = 0; i < edges->length; i++) {
+        if (edgeClassification_getType(eC, &edges->edges[i]) == type) {
+            count++;
         }
-        stSortedSet_destructIterator(it);
-        stSortedSet_destruct(componentNodes);
     }
-
-    return bridgingAdjacencyEdges;
+    return count;
 }
 
-stIntTuple *getLowestScoringEdge(stList *edges) {
+static edgeList *getAdjacencyEdges(edgeClassification *eC, edgeList *edges) {
     /*
-     * Returns edge with lowest weight.
+     * Returns the adjacency edges of the list, in the same order.
      */
-    assert(stList_length(edges) > 0);
-    stIntTuple *lowestScoringEdge = stList_get(edges, 0);
-    int64_t lowestScore = stIntTuple_get(lowestScoringEdge, 2);
-    for (int64_t j = 1; j < stList_length(edges); j++) {
-        stIntTuple *edge = stList_get(edges, j);
-        int64_t k = stIntTuple_get(edge, 2);
-        if (k < lowestScore) {
-            lowestScore = k;
-            lowestScoringEdge = edge;
+    edgeList *adjacencyEdges = edgeList_construct(edges->length);
+    for (int64_t i = 0; i < edges->length; i++) {
+        if (edgeClassification_getType(eC, &edges->edges[i]) == ADJACENCY_EDGE) {
+            edgeList_append(adjacencyEdges, &edges->edges[i]);
         }
     }
-    return lowestScoringEdge;
+    return adjacencyEdges;
 }
 
-static int getBest2EdgeAdjacencySwitchP(const void *o, const void *o2) {
-    int64_t i = stIntTuple_get((void *) o, 2);
-    int64_t j = stIntTuple_get((void *) o2, 2);
-    return i > j ? 1 : (i < j ? -1 : 0);
+static stList *getAdjacencyEdgeComponents(edgeClassification *eC, stList *listOfLists) {
+    /*
+     * Like getStubAndChainEdgeFreeComponents, returns a new list of lists with each sub list filtered to
+     * its adjacency edges, in the same order.
+     */
+    stList *listOfLists2 = stList_construct3(0,
+            (void(*)(void *)) edgeList_destruct);
+    for (int64_t i = 0; i < stList_length(listOfLists); i++) {
+        stList_append(listOfLists2, getAdjacencyEdges(eC, stList_get(listOfLists, i)));
+    }
+    return listOfLists2;
 }
 
-static AdjacencySwitch *getBest2EdgeAdjacencySwitch(stList *components,
-        stSortedSet *allAdjacencyEdges) {
+////////////////////////////////////
+////////////////////////////////////
+//Functions to merge disjoint cycles
+////////////////////////////////////
+////////////////////////////////////
+
+typedef struct _switchQueueEntry {
     /*
-     * Look for the two lowest value adjacency edges in all current edges that are in a separate component and returns them as an adjacency switch
-     * with now new adjacency edges.
+     * An entry of a switch queue. Entries are ordered by cost, then by item, so the order in which they are popped is
+     * deterministic. The versions record the state an entry was computed from, so entries made stale by later merges
+     * can be discarded when they reach the front of the queue.
      */
+    int64_t cost;
+    int64_t item;
+    int64_t version1;
+    int64_t version2;
+    packedEdge edge;
+} switchQueueEntry;
 
+typedef struct _switchQueue {
     /*
-     * Get lowest scoring edge for each component.
+     * A binary min-heap of entries.
      */
-    stList *lowestScoringEdgeFromEachComponent = stList_construct();
-    for (int64_t i = 0; i < stList_length(components); i++) {
-        stList_append(lowestScoringEdgeFromEachComponent,
-                getLowestScoringEdge(stList_get(components, i)));
-    }
+    switchQueueEntry *entries;
+    int64_t length;
+    int64_t maxLength;
+} switchQueue;
+
+static switchQueue *switchQueue_construct(void) {
+    switchQueue *queue = st_malloc(sizeof(switchQueue));
+    queue->length = 0;
+    queue->maxLength = 16;
+    queue->entries = st_malloc(sizeof(switchQueueEntry) * queue->maxLength);
+    return queue;
+}
+
+static void switchQueue_destruct(switchQueue *queue) {
+    free(queue->entries);
+    free(queue);
+}
+
+static bool switchQueue_isLessThan(switchQueueEntry *entry1, switchQueueEntry *entry2) {
+    return entry1->cost < entry2->cost || (entry1->cost == entry2->cost && entry1->item < entry2->item);
+}
 
+static void switchQueue_push(switchQueue *queue, int64_t cost, int64_t item, int64_t version1, int64_t version2,
+        const packedEdge *edge) {
     /*
-     * Get two lowest scoring edges.
+     * Pushes an entry, copying the edge, if it is not NULL.
      */
-    stList_sort(lowestScoringEdgeFromEachComponent,
-            getBest2EdgeAdjacencySwitchP);
-    stIntTuple *lowestScoreEdge1 = stList_get(
-            lowestScoringEdgeFromEachComponent, 0);
-    stIntTuple *lowestScoreEdge2 = stList_get(
-            lowestScoringEdgeFromEachComponent, 1);
-    assert(lowestScoreEdge1 != lowestScoreEdge2);
+    if (queue->length == queue->maxLength) {
+        queue->maxLength *= 2;
+        queue->entries = st_realloc(queue->entries, sizeof(switchQueueEntry) * queue->maxLength);
+    }
+    switchQueueEntry entry = { cost, item, version1, version2, { 0, 0, 0, -1 } };
+    if (edge != NULL) {
+        entry.edge = *edge;
+    }
+    int64_t i = queue->length++;
+    while (i > 0 && switchQueue_isLessThan(&entry, &queue->entries[(i - 1) / 2])) {
+        queue->entries[i] = queue->entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    queue->entries[i] = entry;
+}
 
-    stList_destruct(lowestScoringEdgeFromEachComponent); //Cleanup
+static switchQueueEntry *switchQueue_peek(switchQueue *queue) {
+    return queue->length > 0 ? &queue->entries[0] : NULL;
+}
 
-    stIntTuple *newEdge1 = getWeightedEdgeFromSet(
-            stIntTuple_get(lowestScoreEdge1, 0),
-            stIntTuple_get(lowestScoreEdge2, 0), allAdjacencyEdges);
-    stIntTuple *newEdge2 = getWeightedEdgeFromSet(
-            stIntTuple_get(lowestScoreEdge1, 1),
-            stIntTuple_get(lowestScoreEdge2, 1), allAdjacencyEdges);
-    if (newEdge1 == NULL) {
-        assert(newEdge2 == NULL);
-        newEdge1 = getWeightedEdgeFromSet(
-                stIntTuple_get(lowestScoreEdge1, 0),
-                stIntTuple_get(lowestScoreEdge2, 1), allAdjacencyEdges);
-        newEdge2 = getWeightedEdgeFromSet(
-                stIntTuple_get(lowestScoreEdge1, 1),
-                stIntTuple_get(lowestScoreEdge2, 0), allAdjacencyEdges);
+static switchQueueEntry switchQueue_pop(switchQueue *queue) {
+    assert(queue->length > 0);
+    switchQueueEntry top = queue->entries[0];
+    switchQueueEntry last = queue->entries[--queue->length];
+    int64_t i = 0;
+    while (2 * i + 1 < queue->length) {
+        int64_t j = 2 * i + 1;
+        if (j + 1 < queue->length && switchQueue_isLessThan(&queue->entries[j + 1], &queue->entries[j])) {
+            j++;
+        }
+        if (!switchQueue_isLessThan(&queue->entries[j], &last)) {
+            break;
+        }
+        queue->entries[i] = queue->entries[j];
+        i = j;
     }
-    assert(newEdge1 != NULL);
-    assert(newEdge2 != NULL);
-
-    return adjacencySwitch_construct(
-            lowestScoreEdge1,
-            lowestScoreEdge2,
-            newEdge1,
-            newEdge2,
-            stIntTuple_get(lowestScoreEdge1, 2)
-                    + stIntTuple_get(lowestScoreEdge2, 2));
+    queue->entries[i] = last;
+    return top;
 }
 
-static AdjacencySwitch *getBestAdjacencySwitch(stList *cycles,
-        stList *nonZeroWeightAdjacencyEdges, stSortedSet *allAdjacencyEdges) {
+typedef struct _cycleParity {
     /*
-     * Returns the best 3 or 4 edge switch (one including 3 or 4 edges) for the given existing edge, if they exist, or else NULL.
+     * Alternating odd and even labels for the nodes of a simple cycle, indexed by the position of each node in
+     * a sorted array of the nodes.
      */
-    assert(stList_length(cycles) > 0);
+    int64_t nodeNumber;
+    int64_t *nodes;
+    bool *odd;
+} cycleParity;
 
-    stHash *nodesToNonZeroWeightedAdjacencyEdges = getNodesToEdgesHash(
-            nonZeroWeightAdjacencyEdges);
+static cycleParity *cycleParity_construct(edgeList *cycle) {
+    /*
+     * Walks the cycle once, from the first node of its first edge, which is odd, labelling the nodes alternately.
+     */
+    cycleParity *cP = st_malloc(sizeof(cycleParity));
+    int64_t edgeNumber = cycle->length;
+    assert(edgeNumber % 2 == 0);
+    cP->nodes = getDistinctNodesOfPackedEdges(cycle->edges, edgeNumber, &cP->nodeNumber);
+    assert(cP->nodeNumber == edgeNumber); //In a simple cycle every node has two edges.
+
+    //The two edges of each node, by index in the cycle.
+    int64_t *nodeEdges = st_malloc(sizeof(int64_t) * (2 * cP->nodeNumber + 1));
+    int64_t *degrees = st_calloc(cP->nodeNumber + 1, sizeof(int64_t));
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        for (int64_t j = 0; j < 2; j++) {
+            int64_t nodeIndex = getNodeIndex(cP->nodes, cP->nodeNumber,
+                    j == 0 ? cycle->edges[i].node1 : cycle->edges[i].node2);
+            assert(degrees[nodeIndex] < 2);
+            nodeEdges[2 * nodeIndex + degrees[nodeIndex]++] = i;
+        }
+    }
+    free(degrees);
+
+    cP->odd = st_calloc(cP->nodeNumber + 1, sizeof(bool));
+    int64_t node = cycle->edges[0].node1;
+    int64_t previousEdge = -1;
+    bool odd = 1;
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        int64_t nodeIndex = getNodeIndex(cP->nodes, cP->nodeNumber, node);
+        cP->odd[nodeIndex] = odd;
+        odd = !odd;
+        int64_t edge = nodeEdges[2 * nodeIndex] != previousEdge ? nodeEdges[2 * nodeIndex] : nodeEdges[2 * nodeIndex + 1];
+        node = getOtherNode(&cycle->edges[edge], node);
+        previousEdge = edge;
+    }
+    assert(node == cycle->edges[0].node1);
+    free(nodeEdges);
+    return cP;
+}
 
-    stList *allComponentEdges = stList_join(cycles);
-    assert(stList_length(allComponentEdges) > 0);
-    stHash *nodesToAllCurrentEdgesSet = getNodesToEdgesHash(allComponentEdges);
+static void cycleParity_destruct(cycleParity *cP) {
+    free(cP->nodes);
+    free(cP->odd);
+    free(cP);
+}
 
+static bool cycleParity_isOdd(cycleParity *cP, int64_t node) {
     /*
-     * Get list of adjacency edges that bridge between (have a node in two) components.
+     * Nodes not in the cycle are even.
      */
-    stList *bridgingAdjacencyEdges = getEdgesThatBridgeComponents(cycles,
-            nodesToNonZeroWeightedAdjacencyEdges);
-    stHash *nodesToBridgingAdjacencyEdges = getNodesToEdgesHash(
-            bridgingAdjacencyEdges);
+    int64_t nodeIndex = searchNodeIndex(cP->nodes, cP->nodeNumber, node);
+    return nodeIndex != -1 && cP->odd[nodeIndex];
+}
 
+typedef struct _cycleMerger {
+    /*
+     * The state of a sequence of merges of simple cycles. Nodes are numbered by their position in a sorted array.
+     * Merged cycles are tracked with a union-find over the original cycles. Edges are held by value, and a pair of
+     * nodes without an adjacency edge is joined by a zero weight edge with index -1, so nothing is allocated per edge.
+     */
+    int64_t nodeNumber;
+    int64_t *nodes;
+    packedEdge *currentEdges; //The edge currently incident with each node.
+    int64_t *nodeVersions; //Incremented each time the current edge of a node changes.
+    int64_t *nodeCycles; //The original cycle of each node.
+    int64_t *cycleParents;
+    int64_t *cycleVersions; //Incremented each time a cycle absorbs another.
+    switchQueue **cycleEdges; //For each merged cycle, its edges by weight, including edges since removed.
+    switchQueue *cycleQueue; //Merged cycles by the weight of their lowest weight edge.
+    int64_t bridgingEdgeNumber;
+    packedEdge *bridgingEdges; //Non-zero weight edges between nodes of different original cycles.
+    int64_t *bridgingEdgeNodes; //The indices of the two nodes of each bridging edge.
+    int64_t *nodeOffsets; //The bridging edges of node i are nodeBridgingEdges[nodeOffsets[i]] to nodeBridgingEdges[nodeOffsets[i+1]-1].
+    int64_t *nodeBridgingEdges;
+    switchQueue *fourEdgeSwitches; //Switches using a bridging edge, by cost.
+    edgeIndex *allAdjacencyEdges;
+    bool *oddNodes; //If not NULL, only edges between odd and even nodes may be added.
+} cycleMerger;
+
+static bool cycleMerger_isAllowed(cycleMerger *cM, int64_t node1, int64_t node2) {
     /*
-     * For the best 2 edge switch.
+     * Returns non-zero if an adjacency edge may be added between the two nodes of the cycles.
      */
-    AdjacencySwitch *minimumCostAdjacencySwitch = getBest2EdgeAdjacencySwitch(
-            cycles, allAdjacencyEdges);
+    return cM->oddNodes == NULL || cM->oddNodes[getNodeIndex(cM->nodes, cM->nodeNumber, node1)]
+            != cM->oddNodes[getNodeIndex(cM->nodes, cM->nodeNumber, node2)];
+}
 
+static packedEdge cycleMerger_getAdjacencyEdge(cycleMerger *cM, int64_t node1, int64_t node2) {
     /*
-     * Look for the best 3 or 4 edge switch.
+     * Returns the adjacency edge between the two nodes, which must be allowed. If the nodes have no adjacency edge
+     * they are joined by a zero weight edge with index -1.
      */
-    for (int64_t i = 0; i < stList_length(allComponentEdges); i++) {
-        minimumCostAdjacencySwitch = getMinimumCostAdjacencySwitch(
-                minimumCostAdjacencySwitch,
-                getBest4EdgeAdjacencySwitch2(stList_get(allComponentEdges, i),
-                        allAdjacencyEdges, nodesToAllCurrentEdgesSet,
-                        nodesToBridgingAdjacencyEdges));
+    assert(cycleMerger_isAllowed(cM, node1, node2));
+    packedEdge *edge = edgeIndex_getEdge(cM->allAdjacencyEdges, node1, node2);
+    if (edge != NULL) {
+        return *edge;
     }
-    assert(minimumCostAdjacencySwitch != NULL);
+    packedEdge zeroWeightEdge = { node1 < node2 ? node1 : node2, node1 < node2 ? node2 : node1, 0, -1 };
+    return zeroWeightEdge;
+}
 
+static int64_t cycleMerger_getCycle(cycleMerger *cM, int64_t nodeIndex) {
+    return findRoot(cM->cycleParents, cM->nodeCycles[nodeIndex]);
+}
+
+static packedEdge cycleMerger_getLowestScoringEdge(cycleMerger *cM, int64_t cycle) {
     /*
-     * Cleanup
+     * Returns the lowest weight edge currently in the merged cycle, discarding removed edges from the front of its queue.
      */
-    stList_destruct(allComponentEdges);
-    stList_destruct(bridgingAdjacencyEdges);
-    stHash_destruct(nodesToAllCurrentEdgesSet);
-    stHash_destruct(nodesToBridgingAdjacencyEdges);
-    stHash_destruct(nodesToNonZeroWeightedAdjacencyEdges);
+    switchQueue *edges = cM->cycleEdges[cycle];
+    while (!packedEdge_equals(&cM->currentEdges[switchQueue_peek(edges)->version1], &switchQueue_peek(edges)->edge)) {
+        switchQueue_pop(edges);
+    }
+    return switchQueue_peek(edges)->edge;
+}
 
-    return minimumCostAdjacencySwitch;
+static void cycleMerger_addCycleEdge(cycleMerger *cM, int64_t cycle, const packedEdge *edge) {
+    switchQueue *edges = cM->cycleEdges[cycle];
+    switchQueue_push(edges, edge->weight, edges->length, getNodeIndex(cM->nodes, cM->nodeNumber, edge->node1), 0,
+            edge);
 }
 
-////////////////////////////////////
-////////////////////////////////////
-//Functions to merge disjoint cycles
-////////////////////////////////////
-////////////////////////////////////
+static void cycleMerger_queueCycle(cycleMerger *cM, int64_t cycle) {
+    switchQueue_push(cM->cycleQueue, cycleMerger_getLowestScoringEdge(cM, cycle).weight, cycle,
+            cM->cycleVersions[cycle], 0, NULL);
+}
 
-static void doBestMergeOfTwoSimpleCycles(stList *cycles,
-        stList *nonZeroWeightAdjacencyEdges, stSortedSet *allAdjacencyEdges) {
+static void cycleMerger_queueFourEdgeSwitch(cycleMerger *cM, int64_t bridgingEdge) {
     /*
-     * Merge two simple cycles, using the best possible adjacency switch. Modifies components list in place,
-     * destroying two old components and adding a new one. If new adjacency edges are needed then they are
-     * added to the adjacency edges list.
+     * Queues the switch that replaces the current edges of the two nodes of the bridging edge with the bridging edge
+     * and the edge between their partners.
      */
-    assert(stList_length(cycles) > 1);
+    int64_t nodeIndex1 = cM->bridgingEdgeNodes[2 * bridgingEdge];
+    int64_t nodeIndex2 = cM->bridgingEdgeNodes[2 * bridgingEdge + 1];
+    if (cycleMerger_getCycle(cM, nodeIndex1) == cycleMerger_getCycle(cM, nodeIndex2)) {
+        return; //The bridging edge is now within a cycle.
+    }
+    packedEdge *newEdge1 = &cM->bridgingEdges[bridgingEdge];
+    packedEdge *oldEdge1 = &cM->currentEdges[nodeIndex1];
+    packedEdge *oldEdge2 = &cM->currentEdges[nodeIndex2];
+    int64_t partner1 = getOtherNode(oldEdge1, cM->nodes[nodeIndex1]);
+    int64_t partner2 = getOtherNode(oldEdge2, cM->nodes[nodeIndex2]);
+    packedEdge newEdge2 = cycleMerger_getAdjacencyEdge(cM, partner1, partner2);
+    int64_t cost = oldEdge1->weight + oldEdge2->weight - newEdge1->weight - newEdge2.weight;
+    switchQueue_push(cM->fourEdgeSwitches, cost, bridgingEdge, cM->nodeVersions[nodeIndex1],
+            cM->nodeVersions[nodeIndex2], &newEdge2);
+}
+
+static cycleMerger *cycleMerger_construct(stList *cycles, edgeList *nonZeroWeightAdjacencyEdges,
+        edgeIndex *allAdjacencyEdges, cycleParity *parity) {
+    cycleMerger *cM = st_malloc(sizeof(cycleMerger));
+    cM->allAdjacencyEdges = allAdjacencyEdges;
+    int64_t cycleNumber = stList_length(cycles);
+
+    //Number the nodes.
+    int64_t edgeNumber = 0;
+    for (int64_t i = 0; i < cycleNumber; i++) {
+        edgeNumber += ((edgeList *) stList_get(cycles, i))->length;
+    }
+    cM->nodes = st_malloc(sizeof(int64_t) * (2 * edgeNumber + 1));
+    cM->nodeNumber = 0;
+    for (int64_t i = 0; i < cycleNumber; i++) {
+        edgeList *cycle = stList_get(cycles, i);
+        for (int64_t j = 0; j < cycle->length; j++) {
+            cM->nodes[cM->nodeNumber++] = cycle->edges[j].node1;
+            cM->nodes[cM->nodeNumber++] = cycle->edges[j].node2;
+        }
+    }
+    int64_t nodeNumber = sortDistinctNodes(cM->nodes, cM->nodeNumber);
+    cM->nodeNumber = nodeNumber;
+    assert(cM->nodeNumber == 2 * edgeNumber); //Every node has exactly one current edge.
+    cM->oddNodes = NULL;
+    if (parity != NULL) {
+        cM->oddNodes = st_malloc(sizeof(bool) * (nodeNumber + 1));
+        for (int64_t i = 0; i < nodeNumber; i++) {
+            cM->oddNodes[i] = cycleParity_isOdd(parity, cM->nodes[i]);
+        }
+    }
+
+    //The current edges and cycles of the nodes, and the edges of each cycle.
+    cM->currentEdges = st_malloc(sizeof(packedEdge) * (nodeNumber + 1));
+    cM->nodeVersions = st_calloc(nodeNumber + 1, sizeof(int64_t));
+    cM->nodeCycles = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    cM->cycleParents = st_malloc(sizeof(int64_t) * cycleNumber);
+    cM->cycleVersions = st_calloc(cycleNumber, sizeof(int64_t));
+    cM->cycleEdges = st_malloc(sizeof(switchQueue *) * cycleNumber);
+    cM->cycleQueue = switchQueue_construct();
+    for (int64_t i = 0; i < cycleNumber; i++) {
+        edgeList *cycle = stList_get(cycles, i);
+        assert(cycle->length > 0);
+        cM->cycleParents[i] = i;
+        cM->cycleEdges[i] = switchQueue_construct();
+        for (int64_t j = 0; j < cycle->length; j++) {
+            packedEdge *edge = &cycle->edges[j];
+            for (int64_t k = 0; k < 2; k++) {
+                int64_t nodeIndex = getNodeIndex(cM->nodes, nodeNumber, k == 0 ? edge->node1 : edge->node2);
+                cM->currentEdges[nodeIndex] = *edge;
+                cM->nodeCycles[nodeIndex] = i;
+            }
+            cycleMerger_addCycleEdge(cM, i, edge);
+        }
+        cycleMerger_queueCycle(cM, i);
+    }
+
+    //The bridging edges, indexed by node.
+    cM->bridgingEdges = st_malloc(sizeof(packedEdge) * (nonZeroWeightAdjacencyEdges->length + 1));
+    cM->bridgingEdgeNodes = st_malloc(sizeof(int64_t) * (2 * nonZeroWeightAdjacencyEdges->length + 1));
+    cM->nodeOffsets = st_calloc(nodeNumber + 1, sizeof(int64_t));
+    cM->bridgingEdgeNumber = 0;
+    for (int64_t i = 0; i < nonZeroWeightAdjacencyEdges->length; i++) {
+        packedEdge *edge = &nonZeroWeightAdjacencyEdges->edges[i];
+        int64_t nodeIndex1 = searchNodeIndex(cM->nodes, nodeNumber, edge->node1);
+        int64_t nodeIndex2 = searchNodeIndex(cM->nodes, nodeNumber, edge->node2);
+        if (nodeIndex1 != -1 && nodeIndex2 != -1 && cM->nodeCycles[nodeIndex1] != cM->nodeCycles[nodeIndex2]) {
+            cM->bridgingEdges[cM->bridgingEdgeNumber] = *edge;
+            cM->bridgingEdgeNodes[2 * cM->bridgingEdgeNumber] = nodeIndex1;
+            cM->bridgingEdgeNodes[2 * cM->bridgingEdgeNumber + 1] = nodeIndex2;
+            cM->bridgingEdgeNumber++;
+            cM->nodeOffsets[nodeIndex1 + 1]++;
+            cM->nodeOffsets[nodeIndex2 + 1]++;
+        }
+    }
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        cM->nodeOffsets[i + 1] += cM->nodeOffsets[i];
+    }
+    cM->nodeBridgingEdges = st_malloc(sizeof(int64_t) * (2 * cM->bridgingEdgeNumber + 1));
+    int64_t *positions = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    memcpy(positions, cM->nodeOffsets, sizeof(int64_t) * nodeNumber);
+    for (int64_t i = 0; i < 2 * cM->bridgingEdgeNumber; i++) {
+        cM->nodeBridgingEdges[positions[cM->bridgingEdgeNodes[i]]++] = i / 2;
+    }
+    free(positions);
 
+    //The initial switches.
+    cM->fourEdgeSwitches = switchQueue_construct();
+    for (int64_t i = 0; i < cM->bridgingEdgeNumber; i++) {
+        cycleMerger_queueFourEdgeSwitch(cM, i);
+    }
+    return cM;
+}
+
+static void cycleMerger_destruct(cycleMerger *cM, int64_t cycleNumber) {
+    for (int64_t i = 0; i < cycleNumber; i++) {
+        if (cM->cycleEdges[i] != NULL) {
+            switchQueue_destruct(cM->cycleEdges[i]);
+        }
+    }
+    free(cM->cycleEdges);
+    switchQueue_destruct(cM->cycleQueue);
+    switchQueue_destruct(cM->fourEdgeSwitches);
+    free(cM->nodes);
+    free(cM->currentEdges);
+    free(cM->nodeVersions);
+    free(cM->nodeCycles);
+    free(cM->cycleParents);
+    free(cM->cycleVersions);
+    free(cM->bridgingEdges);
+    free(cM->bridgingEdgeNodes);
+    free(cM->nodeOffsets);
+    free(cM->nodeBridgingEdges);
+    free(cM->oddNodes);
+    free(cM);
+}
+
+static void cycleMerger_doSwitch(cycleMerger *cM, packedEdge oldEdge1, packedEdge oldEdge2, packedEdge newEdge1,
+        packedEdge newEdge2) {
     /*
-     * Get the best adjacency switch.
+     * Replaces the two old edges, which are in different cycles, with the two new edges, which join the same four nodes,
+     * merging the cycles. Only the switches using bridging edges incident with the four nodes are requeued.
      */
-    AdjacencySwitch *adjacencySwitch = getBestAdjacencySwitch(cycles,
-            nonZeroWeightAdjacencyEdges, allAdjacencyEdges);
-    assert(adjacencySwitch != NULL);
+    int64_t cycle1 = cycleMerger_getCycle(cM, getNodeIndex(cM->nodes, cM->nodeNumber, oldEdge1.node1));
+    int64_t cycle2 = cycleMerger_getCycle(cM, getNodeIndex(cM->nodes, cM->nodeNumber, oldEdge2.node1));
+    assert(cycle1 != cycle2);
+
+    //Update the current edges.
+    int64_t nodeIndices[4];
+    for (int64_t i = 0; i < 4; i++) {
+        packedEdge *edge = i < 2 ? &newEdge1 : &newEdge2;
+        nodeIndices[i] = getNodeIndex(cM->nodes, cM->nodeNumber, i % 2 == 0 ? edge->node1 : edge->node2);
+        assert(packedEdge_equals(&cM->currentEdges[nodeIndices[i]], &oldEdge1)
+                || packedEdge_equals(&cM->currentEdges[nodeIndices[i]], &oldEdge2));
+        cM->currentEdges[nodeIndices[i]] = *edge;
+        cM->nodeVersions[nodeIndices[i]]++;
+    }
 
+    //Merge the smaller cycle into the larger.
+    if (cM->cycleEdges[cycle1]->length < cM->cycleEdges[cycle2]->length) {
+        int64_t i = cycle1;
+        cycle1 = cycle2;
+        cycle2 = i;
+    }
+    switchQueue *edges = cM->cycleEdges[cycle2];
+    for (int64_t i = 0; i < edges->length; i++) {
+        switchQueueEntry *entry = &edges->entries[i];
+        if (packedEdge_equals(&cM->currentEdges[entry->version1], &entry->edge)) {
+            cycleMerger_addCycleEdge(cM, cycle1, &entry->edge);
+        }
+    }
+    switchQueue_destruct(edges);
+    cM->cycleEdges[cycle2] = NULL;
+    cM->cycleParents[cycle2] = cycle1;
+    cycleMerger_addCycleEdge(cM, cycle1, &newEdge1);
+    cycleMerger_addCycleEdge(cM, cycle1, &newEdge2);
+    cM->cycleVersions[cycle1]++;
+    cycleMerger_queueCycle(cM, cycle1);
+
+    //Requeue the switches whose old edges have changed.
+    for (int64_t i = 0; i < 4; i++) {
+        for (int64_t j = cM->nodeOffsets[nodeIndices[i]]; j < cM->nodeOffsets[nodeIndices[i] + 1]; j++) {
+            cycleMerger_queueFourEdgeSwitch(cM, cM->nodeBridgingEdges[j]);
+        }
+    }
+}
+
+static switchQueueEntry *cycleMerger_getBestFourEdgeSwitch(cycleMerger *cM) {
     /*
-     * Find the two components to merge.
+     * Returns the lowest cost switch using a bridging edge, or NULL if there is none, discarding stale switches.
      */
-    stList *cyclesToMerge = stList_construct3(0,
-            (void(*)(void *)) stList_destruct);
-    for (int64_t i = 0; i < stList_length(cycles); i++) {
-        stList *cycle = stList_get(cycles, i);
-        if (stList_contains(cycle, adjacencySwitch->oldEdge1)) {
-            assert(!stList_contains(cycle, adjacencySwitch->oldEdge2));
-            stList_append(cyclesToMerge, cycle);
-        } else if (stList_contains(cycle, adjacencySwitch->oldEdge2)) {
-            stList_append(cyclesToMerge, cycle);
+    switchQueueEntry *entry;
+    while ((entry = switchQueue_peek(cM->fourEdgeSwitches)) != NULL) {
+        int64_t nodeIndex1 = cM->bridgingEdgeNodes[2 * entry->item];
+        int64_t nodeIndex2 = cM->bridgingEdgeNodes[2 * entry->item + 1];
+        if (entry->version1 == cM->nodeVersions[nodeIndex1] && entry->version2 == cM->nodeVersions[nodeIndex2]
+                && cycleMerger_getCycle(cM, nodeIndex1) != cycleMerger_getCycle(cM, nodeIndex2)) {
+            return entry;
         }
+        switchQueue_pop(cM->fourEdgeSwitches);
     }
+    return NULL;
+}
 
+static int64_t cycleMerger_getLowestScoringCycle(cycleMerger *cM) {
     /*
-     * Now construct the new component and modify the list of components in place.
+     * Pops the merged cycle whose lowest weight edge is lowest, discarding stale entries.
      */
-    assert(stList_length(cyclesToMerge) == 2);
-    stList *newComponent = stList_join(cyclesToMerge);
-    assert(!stList_contains(newComponent, NULL));
-    //Cleanup the old components
-    assert(stList_contains(cycles, stList_get(cyclesToMerge, 0)));
-    stList_removeItem(cycles, stList_get(cyclesToMerge, 0));
-    assert(stList_contains(cycles, stList_get(cyclesToMerge, 1)));
-    stList_removeItem(cycles, stList_get(cyclesToMerge, 1));
-    stList_destruct(cyclesToMerge);
-    //Now remove the old edges and add the new ones
-    assert(stList_contains(newComponent, adjacencySwitch->oldEdge1));
-    stList_removeItem(newComponent, adjacencySwitch->oldEdge1);
-    assert(stList_contains(newComponent, adjacencySwitch->oldEdge2));
-    stList_removeItem(newComponent, adjacencySwitch->oldEdge2);
-    assert(!stList_contains(newComponent, adjacencySwitch->newEdge1));
-    stList_append(newComponent, adjacencySwitch->newEdge1);
-    assert(!stList_contains(newComponent, adjacencySwitch->newEdge2));
-    stList_append(newComponent, adjacencySwitch->newEdge2);
-    adjacencySwitch_destruct(adjacencySwitch); //Clean the adjacency switch.
-    //Finally add the component to the list of components
-    stList_append(cycles, newComponent);
+    while (1) {
+        switchQueueEntry entry = switchQueue_pop(cM->cycleQueue);
+        if (cM->cycleParents[entry.item] == entry.item && cM->cycleVersions[entry.item] == entry.version1) {
+            return entry.item;
+        }
+    }
+}
 
+static void cycleMerger_doBestMerge(cycleMerger *cM) {
+    /*
+     * Does the lowest cost switch that merges two cycles. The switch either replaces the current edges of the nodes of
+     * a bridging edge with the bridging edge and the edge between their partners, or the lowest weight edges of two cycles
+     * with two edges between their nodes.
+     */
+    //The best 2 edge switch, using the lowest weight edges of the two cycles whose lowest weight edges are lowest.
+    int64_t cycle1 = cycleMerger_getLowestScoringCycle(cM);
+    int64_t cycle2 = cycleMerger_getLowestScoringCycle(cM);
+    packedEdge lowestScoreEdge1 = cycleMerger_getLowestScoringEdge(cM, cycle1);
+    packedEdge lowestScoreEdge2 = cycleMerger_getLowestScoringEdge(cM, cycle2);
+    switchQueue_push(cM->cycleQueue, lowestScoreEdge1.weight, cycle1, cM->cycleVersions[cycle1], 0, NULL);
+    switchQueue_push(cM->cycleQueue, lowestScoreEdge2.weight, cycle2, cM->cycleVersions[cycle2], 0, NULL);
+    int64_t cost = lowestScoreEdge1.weight + lowestScoreEdge2.weight;
+
+    //The best 3 or 4 edge switch is preferred if no more costly.
+    switchQueueEntry *entry = cycleMerger_getBestFourEdgeSwitch(cM);
+    if (entry != NULL && entry->cost <= cost) {
+        switchQueueEntry best = switchQueue_pop(cM->fourEdgeSwitches);
+        cycleMerger_doSwitch(cM, cM->currentEdges[cM->bridgingEdgeNodes[2 * best.item]],
+                cM->currentEdges[cM->bridgingEdgeNodes[2 * best.item + 1]], cM->bridgingEdges[best.item], best.edge);
+        return;
+    }
+    int64_t node1 = lowestScoreEdge2.node1, node2 = lowestScoreEdge2.node2;
+    if (!cycleMerger_isAllowed(cM, lowestScoreEdge1.node1, node1)) {
+        node1 = lowestScoreEdge2.node2;
+        node2 = lowestScoreEdge2.node1;
+    }
+    packedEdge newEdge1 = cycleMerger_getAdjacencyEdge(cM, lowestScoreEdge1.node1, node1);
+    packedEdge newEdge2 = cycleMerger_getAdjacencyEdge(cM, lowestScoreEdge1.node2, node2);
+    cycleMerger_doSwitch(cM, lowestScoreEdge1, lowestScoreEdge2, newEdge1, newEdge2);
+}
+
+static edgeList *mergeSimpleCyclesP(stList *cycles, edgeList *nonZeroWeightAdjacencyEdges,
+        edgeIndex *allAdjacencyEdges, cycleParity *parity, int64_t mergeNumber) {
+    /*
+     * Does mergeNumber merges of the cycles, a list of lists of packed edges, each using the best possible adjacency
+     * switch, and returns the edges of the resulting cycles as one list. If parity is not NULL the new edges must each join
+     * an odd node to an even node. Switches joining nodes without an adjacency edge use zero weight edges with index -1.
+     * Candidate switches are kept in priority queues, and only those touching the edges changed by a merge are
+     * recomputed, so the bridging edges are not rescanned for every merge.
+     */
+    int64_t cycleNumber = stList_length(cycles);
+    assert(mergeNumber < cycleNumber);
+    cycleMerger *cM = cycleMerger_construct(cycles, nonZeroWeightAdjacencyEdges, allAdjacencyEdges, parity);
+    for (int64_t i = 0; i < mergeNumber; i++) {
+        cycleMerger_doBestMerge(cM);
+    }
+    edgeList *mergedEdges = edgeList_construct(cM->nodeNumber / 2);
+    for (int64_t i = 0; i < cM->nodeNumber; i++) {
+        packedEdge *edge = &cM->currentEdges[i];
+        if (edge->node1 == cM->nodes[i]) {
+            edgeList_append(mergedEdges, edge);
+        }
+    }
+    cycleMerger_destruct(cM, cycleNumber);
+    return mergedEdges;
 }
 
 stList *mergeSimpleCycles(stList *cycles, stList *nonZeroWeightAdjacencyEdges,
@@ -526,32 +937,36 @@ stList *mergeSimpleCycles(stList *cycles, stList *nonZeroWeightAdjacencyEdges,
     /*
      * Takes a set of simple cycles (containing only the adjacency edges).
      * Returns a single simple cycle, as a list of edges, by doing length(components)-1
-     * calls to doBestMergeOfTwoSimpleCycles.
+     * merges.
      */
+    stList *table = stList_construct();
+    stList *allAdjacencyEdgesList = stSortedSet_getList(allAdjacencyEdges);
+    edgeList *packedAllAdjacencyEdges = addToEdgeTable(table, allAdjacencyEdgesList);
+    stList_destruct(allAdjacencyEdgesList);
+    edgeIndex *allAdjacencyEdgesIndex = edgeIndex_construct(packedAllAdjacencyEdges->edges,
+            packedAllAdjacencyEdges->length);
+    edgeList *packedNonZeroWeightAdjacencyEdges = addToEdgeTable(table, nonZeroWeightAdjacencyEdges);
+    stList *packedCycles = stList_construct3(0, (void(*)(void *)) edgeList_destruct);
+    for (int64_t i = 0; i < stList_length(cycles); i++) {
+        stList_append(packedCycles, addToEdgeTable(table, stList_get(cycles, i)));
+    }
 
-    /*
-     * Build a hash of nodes to adjacency edges.
-     */
+    edgeList *mergedCycle = mergeSimpleCyclesP(packedCycles, packedNonZeroWeightAdjacencyEdges, allAdjacencyEdgesIndex,
+            NULL, stList_length(cycles) - 1);
+    stList *mergedComponent = getTupleEdges(mergedCycle, table, NULL);
 
-    cycles = stList_copy(cycles, NULL);
-    for (int64_t i = 0; i < stList_length(cycles); i++) { //Clone the complete list
-        assert(stList_length(stList_get(cycles, i)) > 0);
-        assert(!stList_contains(stList_get(cycles, i), NULL));
-        stList_set(cycles, i, stList_copy(stList_get(cycles, i), NULL));
-    }
-    while (stList_length(cycles) > 1) {
-        doBestMergeOfTwoSimpleCycles(cycles, nonZeroWeightAdjacencyEdges,
-                allAdjacencyEdges);
-    }
-    assert(stList_length(cycles) == 1);
-    stList *mergedComponent = stList_get(cycles, 0);
-    stList_destruct(cycles);
+    edgeList_destruct(mergedCycle);
+    stList_destruct(packedCycles);
+    edgeList_destruct(packedNonZeroWeightAdjacencyEdges);
+    edgeIndex_destruct(allAdjacencyEdgesIndex);
+    edgeList_destruct(packedAllAdjacencyEdges);
+    stList_destruct(table);
     return mergedComponent;
 }
 
-static stList *mergeSimpleCycles2(stList *chosenEdges,
-        stList *nonZeroWeightAdjacencyEdges, stSortedSet *allAdjacencyEdges,
-        stList *stubEdges, stList *chainEdges) {
+static edgeList *mergeSimpleCycles2(edgeList *chosenEdges,
+        edgeList *nonZeroWeightAdjacencyEdges, edgeIndex *allAdjacencyEdges,
+        edgeList *stubEdges, edgeList *chainEdges, edgeClassification *eC) {
     /*
      * Returns a new set of chosen edges, modified by adjacency switches such that every simple cycle
      * contains at least one stub edge.
@@ -560,48 +975,47 @@ static stList *mergeSimpleCycles2(stList *chosenEdges,
     /*
      * Calculate components.
      */
-    stList *components = getComponents2(chosenEdges, stubEdges, chainEdges);
+    stList *components = getEdgeListComponents(chosenEdges, stubEdges, chainEdges);
 
     /*
      * Divide the components by the presence of one or more stub edges.
      */
-    stSortedSet *stubEdgesSet = stList_getSortedSet(stubEdges,
-            (int(*)(const void *, const void *)) stIntTuple_cmpFn);
-
     stList *stubContainingComponents = stList_construct();
     stList *stubFreeComponents = stList_construct();
 
     for (int64_t i = 0; i < stList_length(components); i++) {
-        stList *component = stList_get(components, i);
+        edgeList *component = stList_get(components, i);
         stList_append(
-                intersectionSize(stubEdgesSet, component) > 0 ? stubContainingComponents
+                getEdgeNumberOfType(eC, component, STUB_EDGE) > 0 ? stubContainingComponents
                         : stubFreeComponents, component);
     }
     assert(stList_length(stubContainingComponents) > 0);
-    stSortedSet_destruct(stubEdgesSet);
 
     /*
      * Merge the stub containing components into one 'global' component
      */
-    stList *globalComponent = stList_join(stubContainingComponents);
+    edgeList *globalComponent = edgeList_construct(0);
+    for (int64_t i = 0; i < stList_length(stubContainingComponents); i++) {
+        edgeList_appendAll(globalComponent, stList_get(stubContainingComponents, i));
+    }
     stList_destruct(stubContainingComponents);
 
     /*
      * Remove the stub/chain edges from the components.
      */
     stList_append(stubFreeComponents, globalComponent);
-    stList *adjacencyOnlyComponents = getStubAndChainEdgeFreeComponents(
-            stubFreeComponents, stubEdges, chainEdges);
+    stList *adjacencyOnlyComponents = getAdjacencyEdgeComponents(eC, stubFreeComponents);
 
     stList_destruct(stubFreeComponents);
-    stList_destruct(globalComponent);
+    edgeList_destruct(globalComponent);
     stList_destruct(components); //We only clean this up now, as this frees the components it contains.
 
     /*
      * Merge stub free components into the others.
      */
-    stList *updatedChosenEdges = mergeSimpleCycles(adjacencyOnlyComponents,
-            nonZeroWeightAdjacencyEdges, allAdjacencyEdges);
+    edgeList *updatedChosenEdges = mergeSimpleCyclesP(adjacencyOnlyComponents,
+            nonZeroWeightAdjacencyEdges, allAdjacencyEdges, NULL,
+            stList_length(adjacencyOnlyComponents) - 1);
     stList_destruct(adjacencyOnlyComponents);
 
     return updatedChosenEdges;
@@ -613,115 +1027,79 @@ static stList *mergeSimpleCycles2(stList *chosenEdges,
 ////////////////////////////////////
 ////////////////////////////////////
 
-static stSortedSet *getOddNodes(stList *cycle) {
+static edgeList *getOddToEvenAdjacencyEdges(cycleParity *parity,
+        edgeList *adjacencyEdges) {
     /*
-     * Returns alternating nodes in a simple cycle.
+     * Gets edges that include one odd node, but not two.
      */
-
-    //Set to return
-    stSortedSet *nodes = stSortedSet_construct3(
-            (int(*)(const void *, const void *)) stIntTuple_cmpFn,
-            (void(*)(void *)) stIntTuple_destruct);
-
-    stHash *nodesToEdges = getNodesToEdgesHash(cycle);
-    int64_t node = stIntTuple_get(stList_get(cycle, 0), 0);
-    int64_t pNode = -1;
-    int64_t counter = 0;
-    bool b = 1;
-    assert(stList_length(cycle) % 2 == 0);
-    while (counter++ < stList_length(cycle)) {
-        if (b) { //Make alternating
-            addNodeToSet(nodes, node);
-            b = 0;
-        } else {
-            b = 1;
-        }
-        stList *edges = getItemForNode(node, nodesToEdges);
-        assert(stList_length(edges) == 2);
-        stIntTuple *edge = stList_get(edges, 0);
-        int64_t node2 = getOtherPosition(edge, node);
-        if (node2 != pNode) {
-            pNode = node;
-            node = node2;
-            continue;
+    edgeList *oddToEvenAdjacencyEdges = edgeList_construct(0);
+    for (int64_t i = 0; i < adjacencyEdges->length; i++) {
+        packedEdge *edge = &adjacencyEdges->edges[i];
+        if (cycleParity_isOdd(parity, edge->node1) ^ cycleParity_isOdd(parity, edge->node2)) {
+            edgeList_append(oddToEvenAdjacencyEdges, edge);
         }
-        edge = stList_get(edges, 1);
-        node2 = getOtherPosition(edge, node);
-        assert(node2 != pNode);
-        pNode = node;
-        node = node2;
     }
-    stHash_destruct(nodesToEdges);
-
-    assert(stList_length(cycle) / 2 == stSortedSet_size(nodes));
-
-    return nodes;
+    return oddToEvenAdjacencyEdges;
 }
 
-static stList *getOddToEvenAdjacencyEdges(stSortedSet *oddNodes,
-        stList *adjacencyEdges) {
-    /*
-     * Gets edges that include one node in the set of oddNodes, but not both.
-     */
-    stList *oddToEvenAdjacencyEdges = stList_construct();
-    for (int64_t i = 0; i < stList_length(adjacencyEdges); i++) {
-        stIntTuple *edge = stList_get(adjacencyEdges, i);
-        if (nodeInSet(oddNodes, stIntTuple_get(edge, 0)) ^ nodeInSet(
-                oddNodes, stIntTuple_get(edge, 1))) {
-            stList_append(oddToEvenAdjacencyEdges, edge);
-        }
-    }
-    return oddToEvenAdjacencyEdges;
+static int compareEdgeIndices(const void *a, const void *b) {
+    int64_t i = *(const int64_t *) a, j = *(const int64_t *) b;
+    return i < j ? -1 : (i > j ? 1 : 0);
 }
 
-static stSortedSet *getOddToEvenAdjacencyEdges2(stSortedSet *oddNodes,
-        stSortedSet *adjacencyEdges) {
+static void splitIntoAdjacenciesStubsAndChains(edgeList *subCycle,
+        edgeClassification *eC,
+        edgeList **subAdjacencyEdges, edgeList **subStubEdges,
+        edgeList **subChainEdges) {
     /*
-     * Like getOddToEvenAdjacencyEdges, but with a set instead.
+     * Splits run into cycles and chains. The adjacency edges are the non-zero weight adjacency edges
+     * between nodes of the sub-cycle, in the order of the classified list, found from the edges of the nodes of the sub-cycle.
      */
-    stList *adjacencyEdgesList = stSortedSet_getList(adjacencyEdges);
-    stList *oddToEvenAdjacencyEdgesList = getOddToEvenAdjacencyEdges(oddNodes,
-            adjacencyEdgesList);
-    stSortedSet *oddToEvenAdjacencyEdges = stList_getSortedSet(
-            oddToEvenAdjacencyEdgesList,
-            (int(*)(const void *, const void *)) stIntTuple_cmpFn);
-    stList_destruct(adjacencyEdgesList);
-    stList_destruct(oddToEvenAdjacencyEdgesList);
-    return oddToEvenAdjacencyEdges;
-}
-
-static void splitIntoAdjacenciesStubsAndChains(stList *subCycle,
-        stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
-        stList **subAdjacencyEdges, stList **subStubEdges,
-        stList **subChainEdges) {
-    /*
-     * Splits run into cycles and chains..
-     */
-    *subStubEdges = stList_construct();
-    *subChainEdges = stList_construct();
-    for (int64_t j = 0; j < stList_length(subCycle); j++) {
-        stIntTuple *edge = stList_get(subCycle, j);
-        if (stList_contains(stubEdges, edge)) {
-            stList_append(*subStubEdges, edge);
-        } else if (stList_contains(chainEdges, edge)) {
-            stList_append(*subChainEdges, edge);
+    *subStubEdges = edgeList_construct(0);
+    *subChainEdges = edgeList_construct(0);
+    int64_t *nodes = st_malloc(sizeof(int64_t) * (2 * subCycle->length + 1));
+    int64_t nodeNumber = 0;
+    for (int64_t j = 0; j < subCycle->length; j++) {
+        packedEdge *edge = &subCycle->edges[j];
+        edgeType type = edgeClassification_getType(eC, edge);
+        if (type == STUB_EDGE) {
+            edgeList_append(*subStubEdges, edge);
+        } else if (type == CHAIN_EDGE) {
+            edgeList_append(*subChainEdges, edge);
         }
+        nodes[nodeNumber++] = edge->node1;
+        nodes[nodeNumber++] = edge->node2;
+    }
+    int64_t distinctNodeNumber = sortDistinctNodes(nodes, nodeNumber);
+    //Each edge between two nodes of the sub-cycle is found from its first node.
+    int64_t maxEdgeNumber = 0;
+    for (int64_t j = 0; j < distinctNodeNumber; j++) {
+        int64_t nodeIndex = getNodeIndex(eC->nodes, eC->nodeNumber, nodes[j]);
+        maxEdgeNumber += eC->adjacencyOffsets[nodeIndex + 1] - eC->adjacencyOffsets[nodeIndex];
     }
-    *subAdjacencyEdges = stList_construct();
-    stSortedSet *nodes = getNodeSetOfEdges(subCycle);
-    for (int64_t j = 0; j < stList_length(adjacencyEdges); j++) {
-        stIntTuple *edge = stList_get(adjacencyEdges, j);
-        if (nodeInSet(nodes, stIntTuple_get(edge, 0)) && nodeInSet(
-                nodes, stIntTuple_get(edge, 1))) {
-            stList_append(*subAdjacencyEdges, edge);
+    int64_t *edgeIndices = st_malloc(sizeof(int64_t) * (maxEdgeNumber + 1));
+    int64_t edgeNumber = 0;
+    for (int64_t j = 0; j < distinctNodeNumber; j++) {
+        int64_t nodeIndex = getNodeIndex(eC->nodes, eC->nodeNumber, nodes[j]);
+        for (int64_t k = eC->adjacencyOffsets[nodeIndex]; k < eC->adjacencyOffsets[nodeIndex + 1]; k++) {
+            packedEdge *edge = &eC->adjacencyEdges->edges[eC->adjacencyEdgeIndices[k]];
+            if (edge->node1 == nodes[j] && searchNodeIndex(nodes, distinctNodeNumber, edge->node2) != -1) {
+                edgeIndices[edgeNumber++] = eC->adjacencyEdgeIndices[k];
+            }
         }
     }
-    stSortedSet_destruct(nodes);
+    qsort(edgeIndices, edgeNumber, sizeof(int64_t), compareEdgeIndices);
+    *subAdjacencyEdges = edgeList_construct(edgeNumber);
+    for (int64_t j = 0; j < edgeNumber; j++) {
+        edgeList_append(*subAdjacencyEdges, &eC->adjacencyEdges->edges[edgeIndices[j]]);
+    }
+    free(edgeIndices);
+    free(nodes);
 }
 
-static stList *splitMultipleStubCycle(stList *cycle,
-        stList *nonZeroWeightAdjacencyEdges, stSortedSet *allAdjacencyEdges,
-        stList *stubEdges, stList *chainEdges) {
+static stList *splitMultipleStubCycle(edgeList *cycle,
+        edgeList *nonZeroWeightAdjacencyEdges, edgeIndex *allAdjacencyEdges,
+        edgeList *stubEdges, edgeList *chainEdges, edgeClassification *eC) {
     /*
      *  Takes a simple cycle containing k stub edges and splits into k cycles, each containing 1 stub edge.
      */
@@ -730,48 +1108,42 @@ static stList *splitMultipleStubCycle(stList *cycle,
      * Get sub-components containing only adjacency and chain edges.
      */
 
-    stSortedSet *stubAndChainEdgesSet = getSetOfMergedLists(stubEdges,
-            chainEdges);
-    stList *adjacencyEdgeMatching =
-            stList_filterToExclude(cycle, stubAndChainEdgesSet); //Filter out the the non-adjacency edges
+    edgeList *adjacencyEdgeMatching = getAdjacencyEdges(eC, cycle); //Filter out the the non-adjacency edges
     //Make it only the chain edges present in the original component
-    stList *stubFreePaths = getComponents2(adjacencyEdgeMatching, NULL,
+    stList *stubFreePaths = getEdgeListComponents(adjacencyEdgeMatching, NULL,
             chainEdges);
-    stList_destruct(adjacencyEdgeMatching);
+    edgeList_destruct(adjacencyEdgeMatching);
     assert(stList_length(stubFreePaths) >= 1);
 
     stList *splitCycles = stList_construct3(0,
-            (void(*)(void *)) stList_destruct); //The list to return.
+            (void(*)(void *)) edgeList_destruct); //The list to return.
 
 
     if (stList_length(stubFreePaths) > 1) {
         /*
          * Build the list of adjacency edges acceptable in the merge
          */
-        stSortedSet *oddNodes = getOddNodes(cycle);
-        stList *oddToEvenNonZeroWeightAdjacencyEdges =
-                getOddToEvenAdjacencyEdges(oddNodes,
+        cycleParity *parity = cycleParity_construct(cycle);
+        edgeList *oddToEvenNonZeroWeightAdjacencyEdges =
+                getOddToEvenAdjacencyEdges(parity,
                         nonZeroWeightAdjacencyEdges);
-        stSortedSet *oddToEvenAllAdjacencyEdges = getOddToEvenAdjacencyEdges2(oddNodes, allAdjacencyEdges);
 
         /*
          * Merge together the best two components.
          */
-        stList *l = filterListsToExclude(stubFreePaths, stubAndChainEdgesSet);
-        doBestMergeOfTwoSimpleCycles(l, oddToEvenNonZeroWeightAdjacencyEdges,
-                oddToEvenAllAdjacencyEdges); //This is inplace.
-        stList *l2 = stList_join(l);
+        stList *l = getAdjacencyEdgeComponents(eC, stubFreePaths);
+        edgeList *mergedEdges = mergeSimpleCyclesP(l, oddToEvenNonZeroWeightAdjacencyEdges,
+                allAdjacencyEdges, parity, 1);
         stList_destruct(l);
-        l = getComponents2(l2, stubEdges, chainEdges);
+        l = getEdgeListComponents(mergedEdges, stubEdges, chainEdges);
         assert(stList_length(l) == 2);
-        stList_destruct(l2);
+        edgeList_destruct(mergedEdges);
 
         /*
          * Cleanup
          */
-        stSortedSet_destruct(oddNodes);
-        stList_destruct(oddToEvenNonZeroWeightAdjacencyEdges);
-        stSortedSet_destruct(oddToEvenAllAdjacencyEdges);
+        cycleParity_destruct(parity);
+        edgeList_destruct(oddToEvenNonZeroWeightAdjacencyEdges);
 
         /*
          * Call procedure recursively.
@@ -780,19 +1152,18 @@ static stList *splitMultipleStubCycle(stList *cycle,
             /*
              * Split into adjacency edges, stub edges and chain edges.
              */
-            stList *subCycle = stList_get(l, i);
-            stList *subAdjacencyEdges;
-            stList *subStubEdges;
-            stList *subChainEdges;
-            splitIntoAdjacenciesStubsAndChains(subCycle,
-                    nonZeroWeightAdjacencyEdges, stubEdges, chainEdges,
+            edgeList *subCycle = stList_get(l, i);
+            edgeList *subAdjacencyEdges;
+            edgeList *subStubEdges;
+            edgeList *subChainEdges;
+            splitIntoAdjacenciesStubsAndChains(subCycle, eC,
                     &subAdjacencyEdges, &subStubEdges, &subChainEdges);
 
             /*
              * Call recursively.
              */
-            l2 = splitMultipleStubCycle(subCycle, subAdjacencyEdges,
-                    allAdjacencyEdges, subStubEdges, subChainEdges);
+            stList *l2 = splitMultipleStubCycle(subCycle, subAdjacencyEdges,
+                    allAdjacencyEdges, subStubEdges, subChainEdges, eC);
             stList_appendAll(splitCycles, l2);
 
             /*
@@ -800,72 +1171,125 @@ static stList *splitMultipleStubCycle(stList *cycle,
              */
             stList_setDestructor(l2, NULL);
             stList_destruct(l2);
-            stList_destruct(subAdjacencyEdges);
-            stList_destruct(subStubEdges);
-            stList_destruct(subChainEdges);
+            edgeList_destruct(subAdjacencyEdges);
+            edgeList_destruct(subStubEdges);
+            edgeList_destruct(subChainEdges);
         }
         stList_destruct(l);
     } else {
-        stList_append(splitCycles, stList_copy(cycle, NULL));
+        stList_append(splitCycles, edgeList_copy(cycle));
     }
 
-    stSortedSet_destruct(stubAndChainEdgesSet);
     stList_destruct(stubFreePaths);
 
     return splitCycles;
 }
 
-stList *splitMultipleStubCycles(stList *chosenEdges,
-        stList *nonZeroWeightAdjacencyEdges, stSortedSet *allAdjacencyEdges,
-        stList *stubEdges, stList *chainEdges) {
+typedef struct _stubCycleSplits {
+    /*
+     * The cycles to split, shared between threads. The adjacency edges and edge classification are only read, and the
+     * zero weight edges switches need are held by value, so the threads share nothing they write.
+     */
+    stList *cycles;
+    stList **splitCycles; //The split cycles of each cycle, by index.
+    int64_t nextCycle;
+    pthread_mutex_t mutex;
+    edgeIndex *allAdjacencyEdges;
+    edgeClassification *eC;
+} stubCycleSplits;
+
+static void *splitMultipleStubCyclesP(void *arg) {
+    /*
+     * Takes the next unsplit cycle until none are left.
+     */
+    stubCycleSplits *splits = arg;
+    while (1) {
+        pthread_mutex_lock(&splits->mutex);
+        int64_t i = splits->nextCycle++;
+        pthread_mutex_unlock(&splits->mutex);
+        if (i >= stList_length(splits->cycles)) {
+            return NULL;
+        }
+        edgeList *subCycle = stList_get(splits->cycles, i);
+        edgeList *subAdjacencyEdges;
+        edgeList *subStubEdges;
+        edgeList *subChainEdges;
+        splitIntoAdjacenciesStubsAndChains(subCycle, splits->eC,
+                &subAdjacencyEdges, &subStubEdges, &subChainEdges);
+        splits->splitCycles[i] = splitMultipleStubCycle(subCycle,
+                subAdjacencyEdges, splits->allAdjacencyEdges, subStubEdges,
+                subChainEdges, splits->eC);
+        edgeList_destruct(subAdjacencyEdges);
+        edgeList_destruct(subStubEdges);
+        edgeList_destruct(subChainEdges);
+    }
+}
+
+static edgeList *splitMultipleStubCycles(edgeList *chosenEdges,
+        edgeList *nonZeroWeightAdjacencyEdges, edgeIndex *allAdjacencyEdges,
+        edgeList *stubEdges, edgeList *chainEdges, edgeClassification *eC, int64_t threadNumber) {
     /*
      *  Returns an updated list of adjacency edges, such that each stub edge is a member of exactly one cycle.
+     *  The cycles are split independently, using up to threadNumber threads, and the results
+     *  are concatenated in the order of the cycles, so do not depend on the number of threads.
      */
+    assert(threadNumber >= 1);
 
     /*
      * Calculate components.
      */
-    stList *cycles = getComponents2(chosenEdges, stubEdges, chainEdges);
+    stList *cycles = getEdgeListComponents(chosenEdges, stubEdges, chainEdges);
+    edgeClassification_indexAdjacencyEdges(eC, nonZeroWeightAdjacencyEdges);
 
     /*
-     * Find components with multiple stub edges.
+     * Split the components with multiple stub edges.
      */
+    stubCycleSplits splits;
+    splits.cycles = cycles;
+    splits.splitCycles = st_malloc(sizeof(stList *) * (stList_length(cycles) + 1));
+    splits.nextCycle = 0;
+    splits.allAdjacencyEdges = allAdjacencyEdges;
+    splits.eC = eC;
+    pthread_mutex_init(&splits.mutex, NULL);
+    int64_t jobNumber = threadNumber < stList_length(cycles) ? threadNumber : stList_length(cycles);
+    pthread_t *threads = st_malloc(sizeof(pthread_t) * (jobNumber + 1));
+    //The calling thread also splits cycles.
+    for (int64_t i = 1; i < jobNumber; i++) {
+        if (pthread_create(&threads[i], NULL, splitMultipleStubCyclesP, &splits) != 0) {
+            st_errAbort("Failed to create a thread to split stub cycles");
+        }
+    }
+    splitMultipleStubCyclesP(&splits);
+    for (int64_t i = 1; i < jobNumber; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&splits.mutex);
+
     stList *singleStubEdgeCycles = stList_construct3(0,
-            (void(*)(void *)) stList_destruct);
+            (void(*)(void *)) edgeList_destruct);
     for (int64_t i = 0; i < stList_length(cycles); i++) {
-        stList *subCycle = stList_get(cycles, i);
-        stList *subAdjacencyEdges;
-        stList *subStubEdges;
-        stList *subChainEdges;
-        splitIntoAdjacenciesStubsAndChains(subCycle,
-                nonZeroWeightAdjacencyEdges, stubEdges, chainEdges,
-                &subAdjacencyEdges, &subStubEdges, &subChainEdges);
-        stList *splitCycles = splitMultipleStubCycle(subCycle,
-                subAdjacencyEdges, allAdjacencyEdges, subStubEdges,
-                subChainEdges);
+        stList *splitCycles = splits.splitCycles[i];
         stList_appendAll(singleStubEdgeCycles, splitCycles);
         stList_setDestructor(splitCycles, NULL); //Do this to avoid destroying the underlying lists
         stList_destruct(splitCycles);
-        stList_destruct(subAdjacencyEdges);
-        stList_destruct(subStubEdges);
-        stList_destruct(subChainEdges);
     }
+    free(splits.splitCycles);
     stList_destruct(cycles);
 
     /*
      * Remove the stub/chain edges from the components.
      */
-    stSortedSet *stubAndChainEdgesSet = getSetOfMergedLists(stubEdges,
-            chainEdges);
-    stList *adjacencyOnlyComponents = filterListsToExclude(
-            singleStubEdgeCycles, stubAndChainEdgesSet);
+    stList *adjacencyOnlyComponents = getAdjacencyEdgeComponents(eC, singleStubEdgeCycles);
     stList_destruct(singleStubEdgeCycles);
-    stSortedSet_destruct(stubAndChainEdgesSet);
 
     /*
      * Merge the adjacency edges in the components into a single list.
      */
-    stList *updatedChosenEdges = stList_join(adjacencyOnlyComponents);
+    edgeList *updatedChosenEdges = edgeList_construct(chosenEdges->length);
+    for (int64_t i = 0; i < stList_length(adjacencyOnlyComponents); i++) {
+        edgeList_appendAll(updatedChosenEdges, stList_get(adjacencyOnlyComponents, i));
+    }
     stList_destruct(adjacencyOnlyComponents);
 
     return updatedChosenEdges;
@@ -877,96 +1301,303 @@ stList *splitMultipleStubCycles(stList *chosenEdges,
 ////////////////////////////////////
 ////////////////////////////////////
 
-void checkInputs(stSortedSet *nodes, stList *adjacencyEdges,
-        stList *stubEdges, stList *chainEdges) {
+static void checkInputsP(stSortedSet *nodes, stList *adjacencyEdges,
+        stList *stubEdges, stList *chainEdges, bool isClique) {
     /*
-     * Checks the inputs to the algorithm are as expected.
+     * Checks the inputs to the algorithm are as expected, to the level set by setEdgeValidationLevel.
      */
-    int64_t nodeNumber = stSortedSet_size(nodes);
-    assert(nodeNumber % 2 == 0);
-    if (nodeNumber > 0) {
-        assert(stList_length(stubEdges) > 0);
+    if (getEdgeValidationLevel() == EDGE_VALIDATION_OFF) {
+        return;
     }
-    assert(
-            stList_length(stubEdges) + stList_length(chainEdges) == (nodeNumber
-                    / 2));
+    int64_t nodeNumber = stSortedSet_size(nodes);
+    checkEdgesCondition(nodeNumber % 2 == 0, "the number of nodes is odd");
+    checkEdgesCondition(nodeNumber == 0 || stList_length(stubEdges) > 0, "there are no stub edges");
+    checkEdgesCondition(stList_length(stubEdges) + stList_length(chainEdges) == nodeNumber / 2,
+            "the stub and chain edges do not match the number of nodes");
     checkEdges(stubEdges, nodes, 0, 0);
     checkEdges(chainEdges, nodes, 0, 0);
     stList *stubsAndChainEdges = stList_copy(stubEdges, NULL);
     stList_appendAll(stubsAndChainEdges, chainEdges);
     checkEdges(stubsAndChainEdges, nodes, 1, 0);
     stList_destruct(stubsAndChainEdges);
-    checkEdges(adjacencyEdges, nodes, 1, 1);
+    checkEdges(adjacencyEdges, nodes, isClique, isClique);
 }
 
-stList *makeMatchingObeyCyclicConstraints(stSortedSet *nodes,
-        stList *chosenEdges,
-        stSortedSet *allAdjacencyEdges, stList *nonZeroWeightAdjacencyEdges,
-        stList *stubEdges, stList *chainEdges,
-        bool makeStubCyclesDisjoint) {
+void checkInputs(stSortedSet *nodes, stList *adjacencyEdges,
+        stList *stubEdges, stList *chainEdges) {
+    checkInputsP(nodes, adjacencyEdges, stubEdges, chainEdges, 1);
+}
+
+static edgeList *makeMatchingObeyCyclicConstraintsP(stSortedSet *nodes,
+        edgeList *chosenEdges,
+        edgeIndex *allAdjacencyEdges, edgeList *nonZeroWeightAdjacencyEdges,
+        edgeList *stubEdges, edgeList *chainEdges, int64_t firstStubEdge, int64_t firstChainEdge,
+        bool makeStubCyclesDisjoint, int64_t threadNumber) {
+    /*
+     * As makeMatchingObeyCyclicConstraints2, for packed edges indexed in a table of the tuple edges in which the stub
+     * edges start at firstStubEdge and the chain edges, which come last, at firstChainEdge. Returns a new list of the
+     * edges of the matching. Pairs of nodes the switches join without an adjacency edge are joined by zero weight edges
+     * with index -1.
+     */
     if (stSortedSet_size(nodes) == 0) { //Some of the following functions assume there are at least 2 nodes.
-        return stList_construct();
+        return edgeList_construct(0);
     }
 
+    /*
+     * Classify the edges once for all the steps.
+     */
+    edgeClassification *eC = edgeClassification_construct(stubEdges, chainEdges, firstStubEdge, firstChainEdge);
+
     /*
      * Merge in the stub free components.
      */
     chosenEdges = mergeSimpleCycles2(chosenEdges,
             nonZeroWeightAdjacencyEdges, allAdjacencyEdges, stubEdges,
-            chainEdges);
-
-    st_logDebug(
-            "After merging in chain only cycles the matching has %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
-            stList_length(chosenEdges), matchingCardinality(chosenEdges),
-            matchingWeight(chosenEdges));
+            chainEdges, eC);
+    logMatching("After merging in chain only cycles", chosenEdges);
 
     /*
      * Split stub components.
      */
     if (makeStubCyclesDisjoint) {
-        stList *updatedChosenEdges = splitMultipleStubCycles(chosenEdges,
+        edgeList *updatedChosenEdges = splitMultipleStubCycles(chosenEdges,
                 nonZeroWeightAdjacencyEdges, allAdjacencyEdges, stubEdges,
-                chainEdges);
-        stList_destruct(chosenEdges);
+                chainEdges, eC, threadNumber);
+        edgeList_destruct(chosenEdges);
         chosenEdges = updatedChosenEdges;
-        st_logDebug(
-                "After making stub cycles disjoint the matching has %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
-                stList_length(chosenEdges), matchingCardinality(chosenEdges),
-                matchingWeight(chosenEdges));
+        logMatching("After making stub cycles disjoint", chosenEdges);
     } else {
         st_logDebug("Not making stub cycles disjoint\n");
     }
+    edgeClassification_destruct(eC);
 
     return chosenEdges;
 }
 
+stList *makeMatchingObeyCyclicConstraints(stSortedSet *nodes,
+        stList *chosenEdges,
+        stSortedSet *allAdjacencyEdges, stList *nonZeroWeightAdjacencyEdges,
+        stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint) {
+    return makeMatchingObeyCyclicConstraints2(nodes, chosenEdges, allAdjacencyEdges, nonZeroWeightAdjacencyEdges,
+            stubEdges, chainEdges, makeStubCyclesDisjoint, 1);
+}
+
+stList *makeMatchingObeyCyclicConstraints2(stSortedSet *nodes,
+        stList *chosenEdges,
+        stSortedSet *allAdjacencyEdges, stList *nonZeroWeightAdjacencyEdges,
+        stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint, int64_t threadNumber) {
+    /*
+     * Packs the edges once, in a table of the tuple edges with the stub and chain edges last, and only looks the
+     * tuples of the matching up at the end.
+     */
+    stList *table = stList_construct();
+    stList *allAdjacencyEdgesList = stSortedSet_getList(allAdjacencyEdges);
+    edgeList *packedAllAdjacencyEdges = addToEdgeTable(table, allAdjacencyEdgesList);
+    stList_destruct(allAdjacencyEdgesList);
+    edgeIndex *allAdjacencyEdgesIndex = edgeIndex_construct(packedAllAdjacencyEdges->edges,
+            packedAllAdjacencyEdges->length);
+    edgeList *packedNonZeroWeightAdjacencyEdges = addToEdgeTable(table, nonZeroWeightAdjacencyEdges);
+    edgeList *packedChosenEdges = addToEdgeTable(table, chosenEdges);
+    int64_t firstStubEdge = stList_length(table);
+    edgeList *packedStubEdges = addToEdgeTable(table, stubEdges);
+    int64_t firstChainEdge = stList_length(table);
+    edgeList *packedChainEdges = addToEdgeTable(table, chainEdges);
+
+    edgeList *matching = makeMatchingObeyCyclicConstraintsP(nodes, packedChosenEdges, allAdjacencyEdgesIndex,
+            packedNonZeroWeightAdjacencyEdges, packedStubEdges, packedChainEdges, firstStubEdge, firstChainEdge,
+            makeStubCyclesDisjoint, threadNumber);
+    stList *tupleMatching = getTupleEdges(matching, table, NULL);
+
+    edgeList_destruct(matching);
+    edgeList_destruct(packedChainEdges);
+    edgeList_destruct(packedStubEdges);
+    edgeList_destruct(packedChosenEdges);
+    edgeList_destruct(packedNonZeroWeightAdjacencyEdges);
+    edgeIndex_destruct(allAdjacencyEdgesIndex);
+    edgeList_destruct(packedAllAdjacencyEdges);
+    stList_destruct(table);
+    return tupleMatching;
+}
+
+static stList *getMatchingWithCyclicConstraintsP(stSortedSet *nodes,
+        stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber,
+        stList *zeroWeightEdges) {
+    /*
+     * Computes the matching of the checked inputs over packed edges, indexing only the given adjacency edges. The zero
+     * weight edges the final matching uses that are not adjacency edges are created as tuples and appended to
+     * zeroWeightEdges, which may be NULL only if the adjacency edges are a clique.
+     */
+    if (stSortedSet_size(nodes) == 0) { //Some of the following functions assume there are at least 2 nodes.
+        return stList_construct();
+    }
+
+    /*
+     * Pack the edges, in a table of the tuple edges with the stub and chain edges last.
+     */
+    stList *table = stList_construct();
+    edgeList *packedAdjacencyEdges = addToEdgeTable(table, adjacencyEdges);
+    int64_t firstStubEdge = stList_length(table);
+    edgeList *packedStubEdges = addToEdgeTable(table, stubEdges);
+    int64_t firstChainEdge = stList_length(table);
+    edgeList *packedChainEdges = addToEdgeTable(table, chainEdges);
+    edgeIndex *allAdjacencyEdges = edgeIndex_construct(packedAdjacencyEdges->edges, packedAdjacencyEdges->length);
+    edgeList *nonZeroWeightAdjacencyEdges = edgeList_construct(packedAdjacencyEdges->length);
+    for (int64_t i = 0; i < packedAdjacencyEdges->length; i++) {
+        if (packedAdjacencyEdges->edges[i].weight > 0) {
+            edgeList_append(nonZeroWeightAdjacencyEdges, &packedAdjacencyEdges->edges[i]);
+        }
+    }
+
+    edgeList *chosenEdges = st_malloc(sizeof(edgeList));
+    chosenEdges->edges = getPerfectMatchingOfPackedEdges(nodes, packedAdjacencyEdges->edges,
+            packedAdjacencyEdges->length, allAdjacencyEdges, matchingAlgorithm, &chosenEdges->length);
+    chosenEdges->maxLength = chosenEdges->length + 1;
+    logMatching("After the perfect matching", chosenEdges);
+
+    edgeList *updatedChosenEdges = makeMatchingObeyCyclicConstraintsP(nodes, chosenEdges, allAdjacencyEdges,
+            nonZeroWeightAdjacencyEdges, packedStubEdges, packedChainEdges, firstStubEdge, firstChainEdge,
+            makeStubCyclesDisjoint, threadNumber);
+    stList *matching = getTupleEdges(updatedChosenEdges, table, zeroWeightEdges);
+
+    edgeList_destruct(updatedChosenEdges);
+    edgeList_destruct(chosenEdges);
+    edgeList_destruct(nonZeroWeightAdjacencyEdges);
+    edgeIndex_destruct(allAdjacencyEdges);
+    edgeList_destruct(packedChainEdges);
+    edgeList_destruct(packedStubEdges);
+    edgeList_destruct(packedAdjacencyEdges);
+    stList_destruct(table);
+
+    return matching;
+}
+
 stList *getMatchingWithCyclicConstraints(stSortedSet *nodes,
         stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
         bool makeStubCyclesDisjoint,
         stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber)) {
+    return getMatchingWithCyclicConstraints2(nodes, adjacencyEdges, stubEdges, chainEdges, makeStubCyclesDisjoint,
+            matchingAlgorithm, 1);
+}
+
+stList *getMatchingWithCyclicConstraints2(stSortedSet *nodes,
+        stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber) {
     /*
      * Check the inputs.
      */
-    checkInputs(nodes, adjacencyEdges, stubEdges, chainEdges);
+    checkInputsP(nodes, adjacencyEdges, stubEdges, chainEdges, 1);
     st_logDebug("Checked the inputs\n");
 
-    if (stSortedSet_size(nodes) == 0) { //Some of the following functions assume there are at least 2 nodes.
-        return stList_construct();
-    }
+    //The adjacency edges are a clique, so no zero weight edges are created.
+    return getMatchingWithCyclicConstraintsP(nodes, adjacencyEdges, stubEdges, chainEdges,
+            makeStubCyclesDisjoint, matchingAlgorithm, threadNumber, NULL);
+}
 
-    stList *chosenEdges = getPerfectMatching(nodes, adjacencyEdges, matchingAlgorithm);
+stList *getMatchingWithCyclicConstraints3(stSortedSet *nodes,
+        stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber,
+        stList **zeroWeightEdges) {
+    /*
+     * Check the inputs.
+     */
+    checkInputsP(nodes, adjacencyEdges, stubEdges, chainEdges, 0);
+    st_logDebug("Checked the inputs\n");
 
-    stSortedSet *allAdjacencyEdges = stList_getSortedSet(adjacencyEdges,
-                (int(*)(const void *, const void *)) stIntTuple_cmpFn);
-    stList *nonZeroWeightAdjacencyEdges = getEdgesWithGreaterThanZeroWeight(
-                    adjacencyEdges);
+    *zeroWeightEdges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    return getMatchingWithCyclicConstraintsP(nodes, adjacencyEdges, stubEdges, chainEdges,
+            makeStubCyclesDisjoint, matchingAlgorithm, threadNumber, *zeroWeightEdges);
+}
 
-    stList *updatedChosenEdges = makeMatchingObeyCyclicConstraints(nodes, chosenEdges, allAdjacencyEdges, nonZeroWeightAdjacencyEdges, stubEdges, chainEdges, makeStubCyclesDisjoint);
-    stList_destruct(chosenEdges);
-    chosenEdges = updatedChosenEdges;
+/*
+ * Solving batches of problems.
+ */
 
-    stList_destruct(nonZeroWeightAdjacencyEdges);
-    stSortedSet_destruct(allAdjacencyEdges);
+typedef struct _cyclicConstraintsBatch {
+    stList *problems;
+    stList **matchings; //The matching of each problem, by index.
+    stList **zeroWeightEdges; //The created zero weight edges of each problem, by index, or NULL if the adjacency edges are cliques.
+    int64_t nextProblem;
+    pthread_mutex_t mutex;
+    stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber);
+} cyclicConstraintsBatch;
 
-    return chosenEdges;
+static void *solveCyclicConstraintsProblems(void *arg) {
+    /*
+     * Takes the next unsolved problem until none are left, so that threads given quick problems take on more of them.
+     */
+    cyclicConstraintsBatch *batch = arg;
+    while (1) {
+        pthread_mutex_lock(&batch->mutex);
+        int64_t i = batch->nextProblem++;
+        pthread_mutex_unlock(&batch->mutex);
+        if (i >= stList_length(batch->problems)) {
+            return NULL;
+        }
+        cyclicConstraintsProblem *problem = stList_get(batch->problems, i);
+        if (batch->zeroWeightEdges != NULL) {
+            batch->matchings[i] = getMatchingWithCyclicConstraints3(problem->nodes, problem->adjacencyEdges,
+                    problem->stubEdges, problem->chainEdges, problem->makeStubCyclesDisjoint, batch->matchingAlgorithm, 1,
+                    &batch->zeroWeightEdges[i]);
+        } else {
+            batch->matchings[i] = getMatchingWithCyclicConstraints(problem->nodes, problem->adjacencyEdges,
+                    problem->stubEdges, problem->chainEdges, problem->makeStubCyclesDisjoint, batch->matchingAlgorithm);
+        }
+    }
+}
+
+static stList *getMatchingsWithCyclicConstraintsP(stList *problems,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber,
+        stList **zeroWeightEdges) {
+    assert(threadNumber >= 1);
+    cyclicConstraintsBatch batch;
+    batch.problems = problems;
+    batch.matchings = st_malloc(sizeof(stList *) * (stList_length(problems) + 1));
+    batch.zeroWeightEdges = zeroWeightEdges != NULL ? st_malloc(sizeof(stList *) * (stList_length(problems) + 1)) : NULL;
+    batch.nextProblem = 0;
+    batch.matchingAlgorithm = matchingAlgorithm;
+    pthread_mutex_init(&batch.mutex, NULL);
+    int64_t jobNumber = threadNumber < stList_length(problems) ? threadNumber : stList_length(problems);
+    pthread_t *threads = st_malloc(sizeof(pthread_t) * (jobNumber + 1));
+    //The calling thread also solves problems.
+    for (int64_t i = 1; i < jobNumber; i++) {
+        if (pthread_create(&threads[i], NULL, solveCyclicConstraintsProblems, &batch) != 0) {
+            st_errAbort("Failed to create a thread to compute a matching");
+        }
+    }
+    solveCyclicConstraintsProblems(&batch);
+    for (int64_t i = 1; i < jobNumber; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&batch.mutex);
+    stList *matchings = stList_construct3(0, (void (*)(void *)) stList_destruct);
+    for (int64_t i = 0; i < stList_length(problems); i++) {
+        stList_append(matchings, batch.matchings[i]);
+    }
+    free(batch.matchings);
+    if (zeroWeightEdges != NULL) {
+        *zeroWeightEdges = stList_construct3(0, (void (*)(void *)) stList_destruct);
+        for (int64_t i = 0; i < stList_length(problems); i++) {
+            stList_append(*zeroWeightEdges, batch.zeroWeightEdges[i]);
+        }
+        free(batch.zeroWeightEdges);
+    }
+    return matchings;
+}
+
+stList *getMatchingsWithCyclicConstraints(stList *problems,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber) {
+    return getMatchingsWithCyclicConstraintsP(problems, matchingAlgorithm, threadNumber, NULL);
+}
+
+stList *getMatchingsWithCyclicConstraints2(stList *problems,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber,
+        stList **zeroWeightEdges) {
+    return getMatchingsWithCyclicConstraintsP(problems, matchingAlgorithm, threadNumber, zeroWeightEdges);
 }
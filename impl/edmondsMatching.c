@@ -0,0 +1,735 @@
+/*
+ * Copyright (C) 2009-2011 by Benedict Paten (benedictpaten@gmail.com)
+ *
+ * Released under the MIT license, see LICENSE.txt
+ */
+
+/*
+ * edmondsMatching.c
+ *
+ * Maximum weight matching by the primal-dual blossom algorithm of Edmonds, as in externalTools/matchGraph/mwmatching.py,
+ * which this follows step for step, in 64 bit integer arithmetic. It takes O(n^3) time, so is used for weights that
+ * are too large for blossom5, which has a fixed range of costs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sonLib.h"
+#include "shared.h"
+
+/*
+ * A growable array of node, blossom or endpoint indices.
+ */
+
+typedef struct _indexArray {
+    int64_t *values;
+    int64_t length;
+    int64_t maxLength;
+} indexArray;
+
+static void indexArray_init(indexArray *a) {
+    a->length = 0;
+    a->maxLength = 4;
+    a->values = st_malloc(sizeof(int64_t) * a->maxLength);
+}
+
+static void indexArray_clear(indexArray *a) {
+    free(a->values);
+    a->values = NULL;
+    a->length = 0;
+}
+
+static void indexArray_append(indexArray *a, int64_t value) {
+    if (a->length == a->maxLength) {
+        a->maxLength *= 2;
+        a->values = st_realloc(a->values, sizeof(int64_t) * a->maxLength);
+    }
+    a->values[a->length++] = value;
+}
+
+static inline int64_t indexArray_get(indexArray *a, int64_t i) {
+    //Negative indices count back from the end, as the Python code uses them.
+    assert(i >= -a->length && i < a->length);
+    return a->values[i < 0 ? i + a->length : i];
+}
+
+static int64_t indexArray_find(indexArray *a, int64_t value) {
+    for (int64_t i = 0; i < a->length; i++) {
+        if (a->values[i] == value) {
+            return i;
+        }
+    }
+    assert(0);
+    return -1;
+}
+
+static void indexArray_reverse(indexArray *a) {
+    for (int64_t i = 0, j = a->length - 1; i < j; i++, j--) {
+        int64_t value = a->values[i];
+        a->values[i] = a->values[j];
+        a->values[j] = value;
+    }
+}
+
+static void indexArray_rotate(indexArray *a, int64_t i) {
+    //Makes the value at i the first, keeping the cyclic order.
+    int64_t *values = st_malloc(sizeof(int64_t) * a->maxLength);
+    memcpy(values, a->values + i, sizeof(int64_t) * (a->length - i));
+    memcpy(values + a->length - i, a->values, sizeof(int64_t) * i);
+    free(a->values);
+    a->values = values;
+}
+
+/*
+ * State of the algorithm. Nodes are 0 to n-1 and blossoms n to 2n-1, and edge k has endpoints 2k and 2k+1, the first
+ * at its first node and the second at its second node. Labels are 0 for free, 1 for S and 2 for T.
+ */
+
+typedef struct _edmondsState {
+    int64_t nodeNumber;
+    int64_t edgeNumber;
+    packedEdge *edges;
+    bool maximumCardinality;
+    int64_t *endpoint; //The node at each endpoint.
+    int64_t *neighbourOffsets; //The remote endpoints of the edges of node v are neighbourEnds[neighbourOffsets[v]] to neighbourEnds[neighbourOffsets[v+1]-1].
+    int64_t *neighbourEnds;
+    int64_t *mate; //The remote endpoint of the matched edge of each node, or -1.
+    int64_t *label; //The label of each node and top level blossom.
+    int64_t *labelEnd; //The endpoint through which each labelled node or top level blossom got its label, or -1.
+    int64_t *inBlossom; //The top level blossom containing each node.
+    int64_t *blossomParent; //The blossom immediately containing each node or blossom, or -1 for top level.
+    indexArray *blossomChilds; //The sub-blossoms of each blossom, in cyclic order starting with the base.
+    int64_t *blossomBase; //The base node of each blossom, or -1 if the blossom is unused.
+    indexArray *blossomEndps; //The endpoints joining consecutive sub-blossoms of each blossom.
+    int64_t *bestEdge; //The least slack edge to a different S blossom, for each node and top level blossom, or -1.
+    indexArray *blossomBestEdges; //For each S blossom, the least slack edges to each other S blossom, or NULL values if unknown.
+    int64_t *unusedBlossoms;
+    int64_t unusedBlossomNumber;
+    int64_t *dualVar; //The dual variables of the nodes and blossoms, doubled so they stay integers.
+    bool *allowEdge; //Non-zero for edges known to have zero slack.
+    indexArray queue; //S nodes whose edges are to be scanned.
+    int64_t *path; //Scratch space for scanBlossom.
+    int64_t *bestEdgeTo; //Scratch space for addBlossom, kept at -1.
+} edmondsState;
+
+static inline int64_t slack(edmondsState *s, int64_t k) {
+    packedEdge *edge = &s->edges[k];
+    return s->dualVar[edge->node1] + s->dualVar[edge->node2] - 2 * edge->weight;
+}
+
+static int64_t *getLeaves(edmondsState *s, int64_t b, int64_t *leafNumber) {
+    /*
+     * Returns the nodes of the blossom, in the order of a depth first walk of its sub-blossoms.
+     */
+    int64_t *leaves = st_malloc(sizeof(int64_t) * (s->nodeNumber + 1));
+    int64_t *stack = st_malloc(sizeof(int64_t) * (2 * s->nodeNumber + 1));
+    int64_t stackLength = 0;
+    *leafNumber = 0;
+    stack[stackLength++] = b;
+    while (stackLength > 0) {
+        int64_t t = stack[--stackLength];
+        if (t < s->nodeNumber) {
+            leaves[(*leafNumber)++] = t;
+        } else {
+            indexArray *childs = &s->blossomChilds[t];
+            for (int64_t i = childs->length - 1; i >= 0; i--) {
+                stack[stackLength++] = childs->values[i];
+            }
+        }
+    }
+    free(stack);
+    return leaves;
+}
+
+static void assignLabel(edmondsState *s, int64_t w, int64_t t, int64_t p) {
+    /*
+     * Labels node w, and its top level blossom, with t, through endpoint p. Scans the nodes of a new S blossom and
+     * labels the mate of the base of a new T blossom with S.
+     */
+    int64_t b = s->inBlossom[w];
+    assert(s->label[w] == 0 && s->label[b] == 0);
+    s->label[w] = s->label[b] = t;
+    s->labelEnd[w] = s->labelEnd[b] = p;
+    s->bestEdge[w] = s->bestEdge[b] = -1;
+    if (t == 1) {
+        int64_t leafNumber;
+        int64_t *leaves = getLeaves(s, b, &leafNumber);
+        for (int64_t i = 0; i < leafNumber; i++) {
+            indexArray_append(&s->queue, leaves[i]);
+        }
+        free(leaves);
+    } else if (t == 2) {
+        int64_t base = s->blossomBase[b];
+        assert(s->mate[base] >= 0);
+        assignLabel(s, s->endpoint[s->mate[base]], 1, s->mate[base] ^ 1);
+    }
+}
+
+static int64_t scanBlossom(edmondsState *s, int64_t v, int64_t w) {
+    /*
+     * Traces back from S nodes v and w to find either a new blossom, returning its base, or an augmenting path, returning -1.
+     */
+    int64_t pathLength = 0, base = -1;
+    while (v != -1 || w != -1) {
+        int64_t b = s->inBlossom[v];
+        if (s->label[b] & 4) {
+            base = s->blossomBase[b];
+            break;
+        }
+        assert(s->label[b] == 1);
+        s->path[pathLength++] = b;
+        s->label[b] = 5;
+        assert(s->labelEnd[b] == s->mate[s->blossomBase[b]]);
+        if (s->labelEnd[b] == -1) {
+            v = -1;
+        } else {
+            v = s->endpoint[s->labelEnd[b]];
+            b = s->inBlossom[v];
+            assert(s->label[b] == 2);
+            assert(s->labelEnd[b] >= 0);
+            v = s->endpoint[s->labelEnd[b]];
+        }
+        if (w != -1) {
+            int64_t u = v;
+            v = w;
+            w = u;
+        }
+    }
+    for (int64_t i = 0; i < pathLength; i++) {
+        s->label[s->path[i]] = 1;
+    }
+    return base;
+}
+
+static void considerBestEdge(edmondsState *s, int64_t b, int64_t k) {
+    int64_t i = s->edges[k].node1, j = s->edges[k].node2;
+    if (s->inBlossom[j] == b) {
+        j = i;
+    }
+    int64_t bj = s->inBlossom[j];
+    if (bj != b && s->label[bj] == 1 && (s->bestEdgeTo[bj] == -1 || slack(s, k) < slack(s, s->bestEdgeTo[bj]))) {
+        s->bestEdgeTo[bj] = k;
+    }
+}
+
+static void addBlossom(edmondsState *s, int64_t base, int64_t k) {
+    /*
+     * Makes a new blossom with the given base, through S nodes joined by edge k.
+     */
+    int64_t v = s->edges[k].node1, w = s->edges[k].node2;
+    int64_t bb = s->inBlossom[base], bv = s->inBlossom[v], bw = s->inBlossom[w];
+    int64_t b = s->unusedBlossoms[--s->unusedBlossomNumber];
+    s->blossomBase[b] = base;
+    s->blossomParent[b] = -1;
+    s->blossomParent[bb] = b;
+    indexArray *path = &s->blossomChilds[b], *endps = &s->blossomEndps[b];
+    indexArray_init(path);
+    indexArray_init(endps);
+    //Trace back from v to the base.
+    while (bv != bb) {
+        s->blossomParent[bv] = b;
+        indexArray_append(path, bv);
+        indexArray_append(endps, s->labelEnd[bv]);
+        assert(s->label[bv] == 2 || (s->label[bv] == 1 && s->labelEnd[bv] == s->mate[s->blossomBase[bv]]));
+        assert(s->labelEnd[bv] >= 0);
+        v = s->endpoint[s->labelEnd[bv]];
+        bv = s->inBlossom[v];
+    }
+    indexArray_append(path, bb);
+    indexArray_reverse(path);
+    indexArray_reverse(endps);
+    indexArray_append(endps, 2 * k);
+    //Trace back from w to the base.
+    while (bw != bb) {
+        s->blossomParent[bw] = b;
+        indexArray_append(path, bw);
+        indexArray_append(endps, s->labelEnd[bw] ^ 1);
+        assert(s->label[bw] == 2 || (s->label[bw] == 1 && s->labelEnd[bw] == s->mate[s->blossomBase[bw]]));
+        assert(s->labelEnd[bw] >= 0);
+        w = s->endpoint[s->labelEnd[bw]];
+        bw = s->inBlossom[w];
+    }
+    assert(s->label[bb] == 1);
+    s->label[b] = 1;
+    s->labelEnd[b] = s->labelEnd[bb];
+    s->dualVar[b] = 0;
+    //Former T nodes become S nodes, so are scanned.
+    int64_t leafNumber;
+    int64_t *leaves = getLeaves(s, b, &leafNumber);
+    for (int64_t i = 0; i < leafNumber; i++) {
+        if (s->label[s->inBlossom[leaves[i]]] == 2) {
+            indexArray_append(&s->queue, leaves[i]);
+        }
+        s->inBlossom[leaves[i]] = b;
+    }
+    free(leaves);
+    //Find the least slack edges to the other S blossoms.
+    for (int64_t i = 0; i < path->length; i++) {
+        bv = path->values[i];
+        if (s->blossomBestEdges[bv].values == NULL) {
+            leaves = getLeaves(s, bv, &leafNumber);
+            for (int64_t j = 0; j < leafNumber; j++) {
+                for (int64_t l = s->neighbourOffsets[leaves[j]]; l < s->neighbourOffsets[leaves[j] + 1]; l++) {
+                    considerBestEdge(s, b, s->neighbourEnds[l] / 2);
+                }
+            }
+            free(leaves);
+        } else {
+            for (int64_t j = 0; j < s->blossomBestEdges[bv].length; j++) {
+                considerBestEdge(s, b, s->blossomBestEdges[bv].values[j]);
+            }
+        }
+        indexArray_clear(&s->blossomBestEdges[bv]);
+        s->bestEdge[bv] = -1;
+    }
+    indexArray *bestEdges = &s->blossomBestEdges[b];
+    indexArray_init(bestEdges);
+    for (int64_t j = 0; j < 2 * s->nodeNumber; j++) {
+        if (s->bestEdgeTo[j] != -1) {
+            indexArray_append(bestEdges, s->bestEdgeTo[j]);
+            s->bestEdgeTo[j] = -1;
+        }
+    }
+    s->bestEdge[b] = -1;
+    for (int64_t j = 0; j < bestEdges->length; j++) {
+        if (s->bestEdge[b] == -1 || slack(s, bestEdges->values[j]) < slack(s, s->bestEdge[b])) {
+            s->bestEdge[b] = bestEdges->values[j];
+        }
+    }
+}
+
+static void expandBlossom(edmondsState *s, int64_t b, bool endStage) {
+    /*
+     * Expands a top level blossom, relabelling its sub-blossoms if it is a T blossom expanded in the middle of a stage.
+     */
+    indexArray *childs = &s->blossomChilds[b], *endps = &s->blossomEndps[b];
+    for (int64_t i = 0; i < childs->length; i++) {
+        int64_t t = childs->values[i];
+        s->blossomParent[t] = -1;
+        if (t < s->nodeNumber) {
+            s->inBlossom[t] = t;
+        } else if (endStage && s->dualVar[t] == 0) {
+            expandBlossom(s, t, endStage);
+        } else {
+            int64_t leafNumber;
+            int64_t *leaves = getLeaves(s, t, &leafNumber);
+            for (int64_t j = 0; j < leafNumber; j++) {
+                s->inBlossom[leaves[j]] = t;
+            }
+            free(leaves);
+        }
+    }
+    if (!endStage && s->label[b] == 2) {
+        //Relabel the sub-blossoms on the even length path from the entry child to the base as T and S.
+        assert(s->labelEnd[b] >= 0);
+        int64_t entryChild = s->inBlossom[s->endpoint[s->labelEnd[b] ^ 1]];
+        int64_t j = indexArray_find(childs, entryChild), jStep, endpTrick;
+        if (j & 1) {
+            j -= childs->length;
+            jStep = 1;
+            endpTrick = 0;
+        } else {
+            jStep = -1;
+            endpTrick = 1;
+        }
+        int64_t p = s->labelEnd[b];
+        while (j != 0) {
+            s->label[s->endpoint[p ^ 1]] = 0;
+            s->label[s->endpoint[indexArray_get(endps, j - endpTrick) ^ endpTrick ^ 1]] = 0;
+            assignLabel(s, s->endpoint[p ^ 1], 2, p);
+            s->allowEdge[indexArray_get(endps, j - endpTrick) / 2] = 1;
+            j += jStep;
+            p = indexArray_get(endps, j - endpTrick) ^ endpTrick;
+            s->allowEdge[p / 2] = 1;
+            j += jStep;
+        }
+        int64_t bv = indexArray_get(childs, j);
+        s->label[s->endpoint[p ^ 1]] = s->label[bv] = 2;
+        s->labelEnd[s->endpoint[p ^ 1]] = s->labelEnd[bv] = p;
+        s->bestEdge[bv] = -1;
+        j += jStep;
+        //The sub-blossoms on the other path are left free, unless reachable from outside the blossom.
+        while (indexArray_get(childs, j) != entryChild) {
+            bv = indexArray_get(childs, j);
+            if (s->label[bv] == 1) {
+                j += jStep;
+                continue;
+            }
+            int64_t leafNumber, v = -1;
+            int64_t *leaves = getLeaves(s, bv, &leafNumber);
+            for (int64_t l = 0; l < leafNumber; l++) {
+                v = leaves[l];
+                if (s->label[v] != 0) {
+                    break;
+                }
+            }
+            free(leaves);
+            if (s->label[v] != 0) {
+                assert(s->label[v] == 2);
+                assert(s->inBlossom[v] == bv);
+                s->label[v] = 0;
+                s->label[s->endpoint[s->mate[s->blossomBase[bv]]]] = 0;
+                assignLabel(s, v, 2, s->labelEnd[v]);
+            }
+            j += jStep;
+        }
+    }
+    s->label[b] = s->labelEnd[b] = -1;
+    indexArray_clear(childs);
+    indexArray_clear(endps);
+    s->blossomBase[b] = -1;
+    indexArray_clear(&s->blossomBestEdges[b]);
+    s->bestEdge[b] = -1;
+    s->unusedBlossoms[s->unusedBlossomNumber++] = b;
+}
+
+static void augmentBlossom(edmondsState *s, int64_t b, int64_t v) {
+    /*
+     * Swaps the matched and unmatched edges on the path through blossom b from node v to the base, making v the base.
+     */
+    int64_t t = v;
+    while (s->blossomParent[t] != b) {
+        t = s->blossomParent[t];
+    }
+    if (t >= s->nodeNumber) {
+        augmentBlossom(s, t, v);
+    }
+    indexArray *childs = &s->blossomChilds[b], *endps = &s->blossomEndps[b];
+    int64_t i = indexArray_find(childs, t), j = i, jStep, endpTrick;
+    if (i & 1) {
+        j -= childs->length;
+        jStep = 1;
+        endpTrick = 0;
+    } else {
+        jStep = -1;
+        endpTrick = 1;
+    }
+    while (j != 0) {
+        j += jStep;
+        t = indexArray_get(childs, j);
+        int64_t p = indexArray_get(endps, j - endpTrick) ^ endpTrick;
+        if (t >= s->nodeNumber) {
+            augmentBlossom(s, t, s->endpoint[p]);
+        }
+        j += jStep;
+        t = indexArray_get(childs, j);
+        if (t >= s->nodeNumber) {
+            augmentBlossom(s, t, s->endpoint[p ^ 1]);
+        }
+        s->mate[s->endpoint[p]] = p ^ 1;
+        s->mate[s->endpoint[p ^ 1]] = p;
+    }
+    indexArray_rotate(childs, i);
+    indexArray_rotate(endps, i);
+    s->blossomBase[b] = s->blossomBase[childs->values[0]];
+    assert(s->blossomBase[b] == v);
+}
+
+static void augmentMatching(edmondsState *s, int64_t k) {
+    /*
+     * Swaps the matched and unmatched edges on the augmenting path through edge k between two S nodes.
+     */
+    for (int64_t side = 0; side < 2; side++) {
+        int64_t node = side == 0 ? s->edges[k].node1 : s->edges[k].node2;
+        int64_t p = side == 0 ? 2 * k + 1 : 2 * k;
+        while (1) {
+            int64_t bs = s->inBlossom[node];
+            assert(s->label[bs] == 1);
+            assert(s->labelEnd[bs] == s->mate[s->blossomBase[bs]]);
+            if (bs >= s->nodeNumber) {
+                augmentBlossom(s, bs, node);
+            }
+            s->mate[node] = p;
+            if (s->labelEnd[bs] == -1) {
+                break;
+            }
+            int64_t t = s->endpoint[s->labelEnd[bs]];
+            int64_t bt = s->inBlossom[t];
+            assert(s->label[bt] == 2);
+            assert(s->labelEnd[bt] >= 0);
+            node = s->endpoint[s->labelEnd[bt]];
+            int64_t j = s->endpoint[s->labelEnd[bt] ^ 1];
+            assert(s->blossomBase[bt] == t);
+            if (bt >= s->nodeNumber) {
+                augmentBlossom(s, bt, j);
+            }
+            s->mate[j] = s->labelEnd[bt];
+            p = s->labelEnd[bt] ^ 1;
+        }
+    }
+}
+
+static int64_t minimumNodeDual(edmondsState *s) {
+    int64_t minimum = s->dualVar[0];
+    for (int64_t v = 1; v < s->nodeNumber; v++) {
+        if (s->dualVar[v] < minimum) {
+            minimum = s->dualVar[v];
+        }
+    }
+    return minimum;
+}
+
+static bool edmondsStage(edmondsState *s) {
+    /*
+     * Grows alternating trees from the free nodes, adjusting the duals, until an augmenting path is found and applied,
+     * returning non-zero, or the duals show the matching is optimal, returning zero.
+     */
+    int64_t n = s->nodeNumber;
+    for (int64_t i = 0; i < 2 * n; i++) {
+        s->label[i] = 0;
+        s->bestEdge[i] = -1;
+    }
+    for (int64_t b = n; b < 2 * n; b++) {
+        indexArray_clear(&s->blossomBestEdges[b]);
+    }
+    memset(s->allowEdge, 0, sizeof(bool) * s->edgeNumber);
+    s->queue.length = 0;
+    for (int64_t v = 0; v < n; v++) {
+        if (s->mate[v] == -1 && s->label[s->inBlossom[v]] == 0) {
+            assignLabel(s, v, 1, -1);
+        }
+    }
+    while (1) {
+        while (s->queue.length > 0) {
+            int64_t v = s->queue.values[--s->queue.length];
+            assert(s->label[s->inBlossom[v]] == 1);
+            for (int64_t l = s->neighbourOffsets[v]; l < s->neighbourOffsets[v + 1]; l++) {
+                int64_t p = s->neighbourEnds[l], k = p / 2, w = s->endpoint[p], kSlack = 0;
+                if (s->inBlossom[v] == s->inBlossom[w]) {
+                    continue;
+                }
+                if (!s->allowEdge[k]) {
+                    kSlack = slack(s, k);
+                    if (kSlack <= 0) {
+                        s->allowEdge[k] = 1;
+                    }
+                }
+                if (s->allowEdge[k]) {
+                    if (s->label[s->inBlossom[w]] == 0) {
+                        assignLabel(s, w, 2, p ^ 1);
+                    } else if (s->label[s->inBlossom[w]] == 1) {
+                        int64_t base = scanBlossom(s, v, w);
+                        if (base >= 0) {
+                            addBlossom(s, base, k);
+                        } else {
+                            augmentMatching(s, k);
+                            return 1;
+                        }
+                    } else if (s->label[w] == 0) {
+                        assert(s->label[s->inBlossom[w]] == 2);
+                        s->label[w] = 2;
+                        s->labelEnd[w] = p ^ 1;
+                    }
+                } else if (s->label[s->inBlossom[w]] == 1) {
+                    int64_t b = s->inBlossom[v];
+                    if (s->bestEdge[b] == -1 || kSlack < slack(s, s->bestEdge[b])) {
+                        s->bestEdge[b] = k;
+                    }
+                } else if (s->label[w] == 0) {
+                    if (s->bestEdge[w] == -1 || kSlack < slack(s, s->bestEdge[w])) {
+                        s->bestEdge[w] = k;
+                    }
+                }
+            }
+        }
+        //No augmenting path from the tight edges, so find the largest change to the duals that keeps them feasible.
+        int64_t deltaType = -1, delta = 0, deltaEdge = -1, deltaBlossom = -1;
+        if (!s->maximumCardinality) {
+            deltaType = 1;
+            delta = minimumNodeDual(s);
+        }
+        for (int64_t v = 0; v < n; v++) {
+            if (s->label[s->inBlossom[v]] == 0 && s->bestEdge[v] != -1) {
+                int64_t d = slack(s, s->bestEdge[v]);
+                if (deltaType == -1 || d < delta) {
+                    delta = d;
+                    deltaType = 2;
+                    deltaEdge = s->bestEdge[v];
+                }
+            }
+        }
+        for (int64_t b = 0; b < 2 * n; b++) {
+            if (s->blossomParent[b] == -1 && s->label[b] == 1 && s->bestEdge[b] != -1) {
+                int64_t kSlack = slack(s, s->bestEdge[b]);
+                assert(kSlack % 2 == 0);
+                int64_t d = kSlack / 2;
+                if (deltaType == -1 || d < delta) {
+                    delta = d;
+                    deltaType = 3;
+                    deltaEdge = s->bestEdge[b];
+                }
+            }
+        }
+        for (int64_t b = n; b < 2 * n; b++) {
+            if (s->blossomBase[b] >= 0 && s->blossomParent[b] == -1 && s->label[b] == 2
+                    && (deltaType == -1 || s->dualVar[b] < delta)) {
+                delta = s->dualVar[b];
+                deltaType = 4;
+                deltaBlossom = b;
+            }
+        }
+        if (deltaType == -1) {
+            //No further improvement is possible in maximum cardinality mode, so make the duals optimal and stop.
+            assert(s->maximumCardinality);
+            deltaType = 1;
+            delta = minimumNodeDual(s);
+            delta = delta > 0 ? delta : 0;
+        }
+        for (int64_t v = 0; v < n; v++) {
+            if (s->label[s->inBlossom[v]] == 1) {
+                s->dualVar[v] -= delta;
+            } else if (s->label[s->inBlossom[v]] == 2) {
+                s->dualVar[v] += delta;
+            }
+        }
+        for (int64_t b = n; b < 2 * n; b++) {
+            if (s->blossomBase[b] >= 0 && s->blossomParent[b] == -1) {
+                if (s->label[b] == 1) {
+                    s->dualVar[b] += delta;
+                } else if (s->label[b] == 2) {
+                    s->dualVar[b] -= delta;
+                }
+            }
+        }
+        if (deltaType == 1) {
+            return 0;
+        } else if (deltaType == 2) {
+            s->allowEdge[deltaEdge] = 1;
+            int64_t i = s->edges[deltaEdge].node1;
+            if (s->label[s->inBlossom[i]] == 0) {
+                i = s->edges[deltaEdge].node2;
+            }
+            assert(s->label[s->inBlossom[i]] == 1);
+            indexArray_append(&s->queue, i);
+        } else if (deltaType == 3) {
+            s->allowEdge[deltaEdge] = 1;
+            int64_t i = s->edges[deltaEdge].node1;
+            assert(s->label[s->inBlossom[i]] == 1);
+            indexArray_append(&s->queue, i);
+        } else {
+            assert(deltaType == 4);
+            expandBlossom(s, deltaBlossom, 0);
+        }
+    }
+}
+
+stList *chooseMatching_edmonds(stList *edges, int64_t nodeNumber, bool maximumCardinality) {
+    int64_t edgeNumber = stList_length(edges);
+    if (edgeNumber == 0) {
+        return stList_construct();
+    }
+    edmondsState s;
+    int64_t n = nodeNumber;
+    s.nodeNumber = n;
+    s.edgeNumber = edgeNumber;
+    s.edges = getPackedEdges(edges);
+    s.maximumCardinality = maximumCardinality;
+    //Doubled duals and slacks are bounded by a few times the largest weight, or in maximum cardinality mode, where node
+    //duals may become negative, by a multiple of it that grows with the number of nodes.
+    int64_t maxWeight = 0, maxAbsWeight = 0;
+    for (int64_t k = 0; k < edgeNumber; k++) {
+        int64_t weight = s.edges[k].weight;
+        maxWeight = weight > maxWeight ? weight : maxWeight;
+        maxAbsWeight = weight > maxAbsWeight ? weight : (-weight > maxAbsWeight ? -weight : maxAbsWeight);
+    }
+    int64_t maxAllowedWeight = maximumCardinality ? INT64_MAX / (8 * (n + 1)) : INT64_MAX / 8;
+    if (maxAbsWeight > maxAllowedWeight) {
+        st_errAbort("The edge weight %" PRIi64 " is too large to compute a matching in 64 bit arithmetic, whose largest weight"
+                " for %" PRIi64 " nodes is %" PRIi64, maxAbsWeight, n, maxAllowedWeight);
+    }
+    s.endpoint = st_malloc(sizeof(int64_t) * 2 * edgeNumber);
+    s.neighbourOffsets = st_calloc(n + 1, sizeof(int64_t));
+    s.neighbourEnds = st_malloc(sizeof(int64_t) * 2 * edgeNumber);
+    for (int64_t k = 0; k < edgeNumber; k++) {
+        assert(s.edges[k].node1 >= 0 && s.edges[k].node1 < n);
+        assert(s.edges[k].node2 >= 0 && s.edges[k].node2 < n);
+        assert(s.edges[k].node1 != s.edges[k].node2);
+        s.endpoint[2 * k] = s.edges[k].node1;
+        s.endpoint[2 * k + 1] = s.edges[k].node2;
+        s.neighbourOffsets[s.edges[k].node1 + 1]++;
+        s.neighbourOffsets[s.edges[k].node2 + 1]++;
+    }
+    for (int64_t v = 0; v < n; v++) {
+        s.neighbourOffsets[v + 1] += s.neighbourOffsets[v];
+    }
+    int64_t *fill = st_malloc(sizeof(int64_t) * (n + 1));
+    memcpy(fill, s.neighbourOffsets, sizeof(int64_t) * (n + 1));
+    for (int64_t k = 0; k < edgeNumber; k++) {
+        s.neighbourEnds[fill[s.edges[k].node1]++] = 2 * k + 1;
+        s.neighbourEnds[fill[s.edges[k].node2]++] = 2 * k;
+    }
+    free(fill);
+    s.mate = st_malloc(sizeof(int64_t) * n);
+    s.label = st_calloc(2 * n, sizeof(int64_t));
+    s.labelEnd = st_malloc(sizeof(int64_t) * 2 * n);
+    s.inBlossom = st_malloc(sizeof(int64_t) * n);
+    s.blossomParent = st_malloc(sizeof(int64_t) * 2 * n);
+    s.blossomChilds = st_calloc(2 * n, sizeof(indexArray));
+    s.blossomBase = st_malloc(sizeof(int64_t) * 2 * n);
+    s.blossomEndps = st_calloc(2 * n, sizeof(indexArray));
+    s.bestEdge = st_malloc(sizeof(int64_t) * 2 * n);
+    s.blossomBestEdges = st_calloc(2 * n, sizeof(indexArray));
+    s.unusedBlossoms = st_malloc(sizeof(int64_t) * n);
+    s.unusedBlossomNumber = 0;
+    s.dualVar = st_malloc(sizeof(int64_t) * 2 * n);
+    s.allowEdge = st_calloc(edgeNumber, sizeof(bool));
+    indexArray_init(&s.queue);
+    s.path = st_malloc(sizeof(int64_t) * 2 * n);
+    s.bestEdgeTo = st_malloc(sizeof(int64_t) * 2 * n);
+    for (int64_t i = 0; i < 2 * n; i++) {
+        s.labelEnd[i] = -1;
+        s.blossomParent[i] = -1;
+        s.blossomBase[i] = i < n ? i : -1;
+        s.bestEdge[i] = -1;
+        s.dualVar[i] = i < n ? maxWeight : 0;
+        s.bestEdgeTo[i] = -1;
+    }
+    for (int64_t v = 0; v < n; v++) {
+        s.mate[v] = -1;
+        s.inBlossom[v] = v;
+    }
+    for (int64_t b = n; b < 2 * n; b++) {
+        s.unusedBlossoms[s.unusedBlossomNumber++] = b;
+    }
+    //Each stage augments the matching by one edge, or stops.
+    for (int64_t stage = 0; stage < n && edmondsStage(&s); stage++) {
+        for (int64_t b = n; b < 2 * n; b++) {
+            if (s.blossomParent[b] == -1 && s.blossomBase[b] >= 0 && s.label[b] == 1 && s.dualVar[b] == 0) {
+                expandBlossom(&s, b, 1);
+            }
+        }
+    }
+    stList *matching = stList_construct();
+    for (int64_t k = 0; k < edgeNumber; k++) {
+        if (s.mate[s.edges[k].node1] == 2 * k + 1) {
+            assert(s.mate[s.edges[k].node2] == 2 * k);
+            stList_append(matching, stList_get(edges, k));
+        }
+    }
+    for (int64_t b = 0; b < 2 * n; b++) {
+        free(s.blossomChilds[b].values);
+        free(s.blossomEndps[b].values);
+        free(s.blossomBestEdges[b].values);
+    }
+    free(s.edges);
+    free(s.endpoint);
+    free(s.neighbourOffsets);
+    free(s.neighbourEnds);
+    free(s.mate);
+    free(s.label);
+    free(s.labelEnd);
+    free(s.inBlossom);
+    free(s.blossomParent);
+    free(s.blossomChilds);
+    free(s.blossomBase);
+    free(s.blossomEndps);
+    free(s.bestEdge);
+    free(s.blossomBestEdges);
+    free(s.unusedBlossoms);
+    free(s.dualVar);
+    free(s.allowEdge);
+    free(s.queue.values);
+    free(s.path);
+    free(s.bestEdgeTo);
+    return matching;
+}
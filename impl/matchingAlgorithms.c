@@ -12,9 +12,11 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include "commonC.h"
 #include "sonLib.h"
 #include "shared.h"
+#include "blossom5Interface.h"
 
 const char *MATCHING_EXCEPTION = "MATCHING_EXCEPTION";
 
@@ -47,206 +49,385 @@ int64_t matchingWeight(stList *matching) {
 }
 
 /*
- * Code to talk to the blossom5 maximum weight perfect matching algorithm.
+ * Code to talk to the blossom5 minimum cost perfect matching algorithm, which is compiled into the library.
  */
 
-static void writeGraph(FILE *fileHandle, stList *edges, int64_t nodeNumber) {
+blossom5Options blossom5Options_getDefault(void) {
+    blossom5Options options;
+    options.fractionalJumpstart = 1;
+    options.dualGreedyUpdateOption = 0;
+    options.dualLPThreshold = 0.0;
+    options.updateDualsBefore = 0;
+    options.updateDualsAfter = 0;
+    options.singleTreeThreshold = 1.0;
+    return options;
+}
+
+int64_t chooseMatching_getMaximumBlossom5Weight(void) {
+    return blossom5PerfectMatching_getMaximumCost();
+}
+
+static void setBlossom5Options(blossom5PerfectMatching *pM, const blossom5Options *options) {
+    if(options == NULL) {
+        return;
+    }
+    if(!blossom5PerfectMatching_hasDoubleCosts() && (options->dualGreedyUpdateOption == 2 || options->dualLPThreshold > 0.0)) {
+        st_errAbort("The blossom5 options given need the solver to be built with double costs (make blossomDoubleCosts=1)");
+    }
+    blossom5PerfectMatching_setOptions(pM, options->fractionalJumpstart, options->dualGreedyUpdateOption, options->dualLPThreshold,
+            options->updateDualsBefore, options->updateDualsAfter, options->singleTreeThreshold);
+}
+
+static void checkBlossom5Weight(int64_t weight) {
+    if(weight > blossom5PerfectMatching_getMaximumCost() || -weight > blossom5PerfectMatching_getMaximumCost()) {
+        st_errAbort("The edge weight %" PRIi64 " is too large for a matching session, whose largest weight is %" PRIi64
+                " (make blossomDoubleCosts=1 to allow larger weights)", weight, blossom5PerfectMatching_getMaximumCost());
+    }
+}
+
+static bool fitsBlossom5(stList *edges, int64_t edgeBonus) {
     /*
-     * Writes out just the adjacencies in the blossom format.
+     * Returns non-zero if the weights of the edges plus the edgeBonus are all valid blossom5 weights.
      */
-    int64_t edgeNumber = stList_length(edges);
-    fprintf(fileHandle, "%" PRIi64 " %" PRIi64 "\n", nodeNumber, edgeNumber);
     for(int64_t i=0; i<stList_length(edges); i++) {
-        stIntTuple *edge = stList_get(edges, i);
-        int64_t from =  stIntTuple_get(edge, 0);
-        int64_t to = stIntTuple_get(edge, 1);
-        int64_t weight = stIntTuple_get(edge, 2);
-        //All the algorithms are minimisation algorithms, so we invert the sign.
-        fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " %" PRIi64 "\n", from, to, weight);
+        int64_t weight = stIntTuple_get(stList_get(edges, i), 2);
+        if(weight > blossom5PerfectMatching_getMaximumCost() - edgeBonus || weight < -blossom5PerfectMatching_getMaximumCost() - edgeBonus) {
+            return 0;
+        }
     }
+    return 1;
 }
 
-static void writeCliqueGraph(FILE *fileHandle, stList *edges, int64_t nodeNumber, bool negativeWeights) {
+static stList *chooseMatching_blossom5P(stList *edges, int64_t nodeNumber, int64_t edgeBonus,
+        const blossom5Options *options) {
     /*
-     * Writes out a representation of the adjacencies and ends as a graph readable by blossom.
-     * Writes out additional edges so that every pair of nodes is connected.
+     * Runs blossom5 in process. To guarantee a perfect matching exists without making the graph a clique, each node i is given a
+     * copy i + nodeNumber, joined to it by a zero weight edge, and each edge is mirrored with zero weight between the copies.
+     * Any matching of the edges then extends to a perfect matching of the same weight, so the minimum cost perfect matching
+     * of the doubled graph contains a maximum weight matching of the edges. The size of the problem is linear in the number of edges.
+     *
+     * The edgeBonus is added to the weight of every edge, if greater than the weight of any matching it makes the result
+     * a maximum weight matching among the matchings of maximum cardinality.
+     *
+     * Weights outside the range of blossom5 costs are matched with the Edmonds algorithm in 64 bit integers instead.
      */
-    int64_t edgeNumber = ((nodeNumber * nodeNumber)  - nodeNumber) / 2;
-    fprintf(fileHandle, "%" PRIi64 " %" PRIi64 "\n", nodeNumber, edgeNumber);
-    stSortedSet *seen = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn, (void (*)(void *))stIntTuple_destruct);
-    int64_t edgesWritten = 0;
-    for(int64_t i=0; i<stList_length(edges); i++) {
+    if(nodeNumber <= 1) {
+        assert(stList_length(edges) == 0);
+        return stList_construct();
+    }
+    if(!fitsBlossom5(edges, edgeBonus)) {
+        assert(edgeBonus == 0);
+        st_logDebug("Edge weights are too large for blossom5, so computing the matching with the Edmonds algorithm\n");
+        return chooseMatching_edmonds(edges, nodeNumber, 0);
+    }
+    int64_t edgeNumber = stList_length(edges);
+    blossom5PerfectMatching *pM = blossom5PerfectMatching_construct(2 * nodeNumber, 2 * edgeNumber + nodeNumber);
+    setBlossom5Options(pM, options);
+    for(int64_t i=0; i<edgeNumber; i++) {
         stIntTuple *edge = stList_get(edges, i);
-        int64_t from =  stIntTuple_get(edge, 0);
+        int64_t from = stIntTuple_get(edge, 0);
         int64_t to = stIntTuple_get(edge, 1);
         assert(from < nodeNumber);
         assert(to < nodeNumber);
         assert(from >= 0);
         assert(to >= 0);
         assert(from != to);
-        int64_t weight = stIntTuple_get(edge, 2);
-        //If is a minimisation algorithms we invert the sign..
-        fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " %" PRIi64 "\n", from, to, negativeWeights ? -weight : weight);
-        edgesWritten++;
-        addEdgeToSet(seen, from, to);
+        int64_t weight = stIntTuple_get(edge, 2) + edgeBonus;
+        //Blossom5 is a minimisation algorithm, so we invert the sign.
+        int64_t j = blossom5PerfectMatching_addEdge(pM, from, to, -weight);
+        assert(j == i); //The edges of the original graph have the same indices as in the list.
+        (void)j;
+    }
+    for(int64_t i=0; i<edgeNumber; i++) {
+        stIntTuple *edge = stList_get(edges, i);
+        blossom5PerfectMatching_addEdge(pM, stIntTuple_get(edge, 0) + nodeNumber, stIntTuple_get(edge, 1) + nodeNumber, 0);
     }
     for(int64_t i=0; i<nodeNumber; i++) {
-        for(int64_t j=i+1; j<nodeNumber; j++) {
-            if(!edgeInSet(seen, i, j)) {
-                fprintf(fileHandle, "%" PRIi64 " %" PRIi64 " 0\n", i, j);
-                edgesWritten++;
-            }
+        blossom5PerfectMatching_addEdge(pM, i, i + nodeNumber, 0);
+    }
+    blossom5PerfectMatching_solve(pM);
+    //Get back the matching, discarding the edges between the copies.
+    stList *matching = stList_construct();
+    for(int64_t i=0; i<edgeNumber; i++) {
+        if(blossom5PerfectMatching_getSolution(pM, i)) {
+            stList_append(matching, stList_get(edges, i));
         }
     }
-    //Cleanup
-    stSortedSet_destruct(seen);
-    assert(edgeNumber == edgesWritten);
+    blossom5PerfectMatching_destruct(pM);
+    st_logDebug("The adjacency matching for %" PRIi64 " nodes with %" PRIi64 " initial edges contains %" PRIi64 " edges\n", nodeNumber, stList_length(edges), stList_length(matching));
+    return matching;
 }
 
-static stHash *putEdgesInHash(stList *edges) {
-    stHash *intsToEdgesHash = stHash_construct3((uint64_t (*)(const void *))stIntTuple_hashKey, (int (*)(const void *, const void *))stIntTuple_equalsFn, (void (*)(void *))stIntTuple_destruct, NULL);
-    for(int64_t i=0; i<stList_length(edges); i++) {
-        stIntTuple *edge = stList_get(edges, i);
-        stHash_insert(intsToEdgesHash, constructEdge(stIntTuple_get(edge, 0), stIntTuple_get(edge, 1)), edge);
-    }
-    return intsToEdgesHash;
+stList *chooseMatching_blossom5(stList *edges, int64_t nodeNumber) {
+    return chooseMatching_blossom5P(edges, nodeNumber, 0, NULL);
 }
 
-static stList *readMatching(FILE *fileHandle, stList *originalEdges) {
+stList *chooseMatching_maximumCardinalityMatching2(stList *edges, int64_t nodeNumber, const blossom5Options *options) {
     /*
-     * Reads the matching created by Blossum.
+     * Gives each edge a bonus greater than the weight of any matching, so that matchings with more edges are always preferred.
      */
-    stHash *originalEdgesHash = putEdgesInHash(originalEdges);
-    char *line = stFile_getLineFromFile(fileHandle);
-    assert(line != NULL);
-    int64_t nodeNumber, edgeNumber;
-    int64_t i = sscanf(line, "%" PRIi64 " %" PRIi64 "\n", &nodeNumber, &edgeNumber);
-    assert(i == 2);
-    free(line);
-    stList *chosenEdges = stList_construct();
-    for(int64_t j=0; j<edgeNumber; j++) {
-        line = stFile_getLineFromFile(fileHandle);
-        int64_t node1, node2;
-        i = sscanf(line, "%" PRIi64 " %" PRIi64 "", &node1, &node2);
-        assert(i == 2);
-        free(line);
-        assert(node1 >= 0);
-        assert(node1 < nodeNumber);
-        assert(node2 >= 0);
-        assert(node2 < nodeNumber);
-        stIntTuple *edge = constructEdge(node1, node2);
-        stIntTuple *originalEdge = stHash_search(originalEdgesHash, edge);
-        if(originalEdge != NULL) {
-            stList_append(chosenEdges, originalEdge);
+    int64_t maxWeight = 0;
+    for(int64_t i=0; i<stList_length(edges); i++) {
+        int64_t weight = stIntTuple_get(stList_get(edges, i), 2);
+        if(weight > maxWeight) {
+            maxWeight = weight;
         }
-        stIntTuple_destruct(edge);
     }
-    stHash_destruct(originalEdgesHash);
-    return chosenEdges;
+    //The bonus plus the largest weight, maxWeight * (nodeNumber / 2 + 1) + 1, must be a valid blossom5 weight, otherwise
+    //the Edmonds algorithm finds the maximum cardinality matching directly.
+    if(maxWeight > (blossom5PerfectMatching_getMaximumCost() - 1) / (nodeNumber / 2 + 1)) {
+        st_logDebug("Edge weights are too large to break ties by weight in blossom5, so computing the maximum cardinality matching with the Edmonds algorithm\n");
+        return chooseMatching_edmonds(edges, nodeNumber, 1);
+    }
+    return chooseMatching_blossom5P(edges, nodeNumber, maxWeight * (nodeNumber / 2) + 1, options);
 }
 
-static stList *chooseAdjacencyPairing_externalProgram(stList *edges, int64_t nodeNumber, const char *programName) {
-    /*
-     * We create temp files to hold stuff.
-     */
-    if(nodeNumber <= 1) {
-        assert(stList_length(edges) == 0);
-        return stList_construct();
-    }
+stList *chooseMatching_maximumCardinalityMatching(stList *edges, int64_t nodeNumber) {
+    return chooseMatching_maximumCardinalityMatching2(edges, nodeNumber, NULL);
+}
 
-    char *tempInputFile = getTempFile(), *tempOutputFile = getTempFile();
+stList *chooseMatching_maximumWeightMatching2(stList *edges, int64_t nodeNumber, const blossom5Options *options) {
+    return chooseMatching_blossom5P(edges, nodeNumber, 0, options);
+}
 
+stList *chooseMatching_maximumWeightMatching(stList *edges, int64_t nodeNumber) {
+    return chooseMatching_blossom5P(edges, nodeNumber, 0, NULL);
+}
+
+/*
+ * Matching sessions, which keep the blossom5 solution between changes to the edges.
+ */
+
+struct _matchingSession {
+    int64_t nodeNumber;
+    packedEdge *edges; //The edges, with their current weights.
+    int64_t *blossomEdges; //The index in the blossom5 problem of each edge.
+    int64_t edgeNumber;
+    int64_t maxEdgeNumber;
+    blossom5PerfectMatching *pM;
+    int64_t blossomEdgeNumber; //The number of edges in the blossom5 problem.
+    int64_t maxBlossomEdgeNumber; //The number of edges the blossom5 problem has room for.
+    bool hasOptions; //Non-zero if options should be given to the solver, rather than the defaults.
+    blossom5Options options; //Kept so that the problem can be remade with the same options.
+    bool updating; //Non-zero if the edges have changed since the problem was last solved.
+};
+
+static void matchingSession_makeProblem(matchingSession *mS, int64_t maxBlossomEdgeNumber) {
     /*
-     * We write the graph to a temp file.
+     * Makes the same doubled graph as chooseMatching_blossom5P from the current edges, so that there is a perfect
+     * matching however the edges change, and solves it. The problem has room for maxBlossomEdgeNumber edges, as
+     * blossom5 reports to stdout if it has to make more room itself.
      */
-    FILE *fileHandle = fopen(tempInputFile, "w");
-    if(strcmp(programName, "blossom5") == 0) { //Must be all connected as
-        //generates perfect matchings.
-        writeCliqueGraph(fileHandle, edges, nodeNumber, 1);
+    int64_t nodeNumber = mS->nodeNumber;
+    assert(maxBlossomEdgeNumber >= 2 * mS->edgeNumber + nodeNumber);
+    mS->pM = blossom5PerfectMatching_construct(2 * nodeNumber, maxBlossomEdgeNumber);
+    mS->maxBlossomEdgeNumber = maxBlossomEdgeNumber;
+    mS->updating = 0;
+    setBlossom5Options(mS->pM, mS->hasOptions ? &mS->options : NULL);
+    for(int64_t i=0; i<mS->edgeNumber; i++) {
+        packedEdge *edge = &mS->edges[i];
+        mS->blossomEdges[i] = blossom5PerfectMatching_addEdge(mS->pM, edge->node1, edge->node2, -edge->weight);
+    }
+    for(int64_t i=0; i<mS->edgeNumber; i++) {
+        blossom5PerfectMatching_addEdge(mS->pM, mS->edges[i].node1 + nodeNumber, mS->edges[i].node2 + nodeNumber, 0);
+    }
+    for(int64_t i=0; i<nodeNumber; i++) {
+        blossom5PerfectMatching_addEdge(mS->pM, i, i + nodeNumber, 0);
     }
-    else {
-        writeGraph(fileHandle, edges, nodeNumber);
+    mS->blossomEdgeNumber = 2 * mS->edgeNumber + nodeNumber;
+    if(nodeNumber > 0) {
+        blossom5PerfectMatching_solve(mS->pM);
     }
-    fclose(fileHandle);
+}
 
-    /*
-     * We run the external program.
-     */
-    char *command = stString_print("%s -e %s -w %s > /dev/null", programName, tempInputFile, tempOutputFile);
-    int64_t i = st_system(command);
-    if(i != 0) {
-        st_errAbort("Something went wrong with the command: %s", command);
-        //For some reason this causes a seg fault
-        //stThrowNew(MATCHING_EXCEPTION, "Something went wrong with the command: %s", command);
+matchingSession *matchingSession_construct3(stList *edges, int64_t nodeNumber, const blossom5Options *options,
+        int64_t expectedEdgeAdditions) {
+    assert(expectedEdgeAdditions >= 0);
+    matchingSession *mS = st_malloc(sizeof(matchingSession));
+    int64_t edgeNumber = stList_length(edges);
+    mS->nodeNumber = nodeNumber;
+    mS->edges = getPackedEdges(edges);
+    mS->edgeNumber = edgeNumber;
+    mS->maxEdgeNumber = edgeNumber + 1;
+    mS->blossomEdges = st_malloc(sizeof(int64_t) * mS->maxEdgeNumber);
+    mS->hasOptions = options != NULL;
+    if(options != NULL) {
+        mS->options = *options;
+    }
+    for(int64_t i=0; i<edgeNumber; i++) {
+        packedEdge *edge = &mS->edges[i];
+        assert(edge->node1 >= 0 && edge->node1 < nodeNumber);
+        assert(edge->node2 >= 0 && edge->node2 < nodeNumber);
+        assert(edge->node1 != edge->node2);
+        checkBlossom5Weight(edge->weight);
     }
-    free(command);
+    //Each added edge and its mirror between the copies takes two places.
+    matchingSession_makeProblem(mS, 2 * (edgeNumber + expectedEdgeAdditions) + nodeNumber);
+    return mS;
+}
 
-    /*
-     * We get back the matching.
-     */
-    fileHandle = fopen(tempOutputFile, "r");
-    stList *matching = readMatching(fileHandle, edges);
-    fclose(fileHandle);
-    st_logDebug("The adjacency matching for %" PRIi64 " nodes with %" PRIi64 " initial edges contains %" PRIi64 " edges\n", nodeNumber, stList_length(edges), stList_length(matching));
+matchingSession *matchingSession_construct2(stList *edges, int64_t nodeNumber, const blossom5Options *options) {
+    return matchingSession_construct3(edges, nodeNumber, options, stList_length(edges));
+}
 
-    /*
-     * Get rid of the temp files..
-     */
-    st_system("rm -rf %s %s", tempInputFile, tempOutputFile);
-    free(tempInputFile);
-    free(tempOutputFile);
+matchingSession *matchingSession_construct(stList *edges, int64_t nodeNumber) {
+    return matchingSession_construct2(edges, nodeNumber, NULL);
+}
 
-    return matching;
+void matchingSession_destruct(matchingSession *mS) {
+    blossom5PerfectMatching_destruct(mS->pM);
+    free(mS->edges);
+    free(mS->blossomEdges);
+    free(mS);
 }
 
-stList *chooseMatching_blossom5(stList *edges, int64_t nodeNumber) {
-    return chooseAdjacencyPairing_externalProgram(edges, nodeNumber, "blossom5");
+static void matchingSession_startUpdate(matchingSession *mS) {
+    if(!mS->updating) {
+        blossom5PerfectMatching_startUpdate(mS->pM);
+        mS->updating = 1;
+    }
 }
 
-stList *chooseMatching_maximumCardinalityMatching(stList *edges, int64_t nodeNumber) {
-    return chooseAdjacencyPairing_externalProgram(edges, nodeNumber, "matchGraph.py -c");
+int64_t matchingSession_addEdge(matchingSession *mS, int64_t node1, int64_t node2, int64_t weight) {
+    assert(node1 >= 0 && node1 < mS->nodeNumber);
+    assert(node2 >= 0 && node2 < mS->nodeNumber);
+    assert(node1 != node2);
+    checkBlossom5Weight(weight);
+    int64_t edgeIndex = mS->edgeNumber++;
+    if(edgeIndex >= mS->maxEdgeNumber) {
+        mS->maxEdgeNumber *= 2;
+        mS->blossomEdges = st_realloc(mS->blossomEdges, sizeof(int64_t) * mS->maxEdgeNumber);
+        mS->edges = st_realloc(mS->edges, sizeof(packedEdge) * mS->maxEdgeNumber);
+    }
+    mS->edges[edgeIndex].node1 = node1 < node2 ? node1 : node2;
+    mS->edges[edgeIndex].node2 = node1 < node2 ? node2 : node1;
+    mS->edges[edgeIndex].weight = weight;
+    mS->edges[edgeIndex].index = edgeIndex;
+    if(mS->blossomEdgeNumber + 2 > mS->maxBlossomEdgeNumber) {
+        //Out of room, so remake the problem with twice the room, including the new edge, starting the solution again.
+        blossom5PerfectMatching_destruct(mS->pM);
+        matchingSession_makeProblem(mS, 2 * mS->maxBlossomEdgeNumber + 2);
+        return edgeIndex;
+    }
+    matchingSession_startUpdate(mS);
+    mS->blossomEdges[edgeIndex] = blossom5PerfectMatching_addNewEdge(mS->pM, node1, node2, -weight);
+    blossom5PerfectMatching_addNewEdge(mS->pM, node1 + mS->nodeNumber, node2 + mS->nodeNumber, 0);
+    mS->blossomEdgeNumber += 2;
+    return edgeIndex;
 }
 
-stList *chooseMatching_maximumWeightMatching(stList *edges, int64_t nodeNumber) {
-    return chooseAdjacencyPairing_externalProgram(edges, nodeNumber, "matchGraph.py");
+void matchingSession_setWeight(matchingSession *mS, int64_t edgeIndex, int64_t weight) {
+    assert(edgeIndex >= 0 && edgeIndex < mS->edgeNumber);
+    int64_t oldWeight = mS->edges[edgeIndex].weight;
+    if(weight == oldWeight) {
+        return;
+    }
+    checkBlossom5Weight(weight);
+    matchingSession_startUpdate(mS);
+    //Costs are negated weights.
+    blossom5PerfectMatching_updateCost(mS->pM, mS->blossomEdges[edgeIndex], oldWeight - weight);
+    mS->edges[edgeIndex].weight = weight;
+}
+
+stList *matchingSession_getMatching(matchingSession *mS) {
+    if(mS->updating) {
+        blossom5PerfectMatching_finishUpdate(mS->pM);
+        blossom5PerfectMatching_solve(mS->pM);
+        mS->updating = 0;
+    }
+    stList *matching = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    for(int64_t i=0; i<mS->edgeNumber; i++) {
+        if(blossom5PerfectMatching_getSolution(mS->pM, mS->blossomEdges[i])) {
+            packedEdge *edge = &mS->edges[i];
+            stList_append(matching, constructWeightedEdge(edge->node1, edge->node2, edge->weight));
+        }
+    }
+    return matching;
 }
 
 /*
  * Greedy matching algorithm.
  */
 
-int chooseMatching_greedyP(const void *a, const void *b) {
-    return stIntTuple_get((stIntTuple *)a, 2) - stIntTuple_get((stIntTuple *)b, 2);
+typedef struct _greedyEdge {
+    uint64_t key; //Ascending order of key is descending order of weight.
+    int64_t from;
+    int64_t to;
+    int64_t index; //Index of the edge in the input list.
+} greedyEdge;
+
+static greedyEdge *radixSortGreedyEdges(greedyEdge *greedyEdges, greedyEdge *buffer, int64_t edgeNumber) {
+    /*
+     * Stable least significant digit radix sort by key, a byte at a time, returning whichever of the two arrays holds the result.
+     * Bytes that are the same for every key are skipped, so small weights take only one or two passes.
+     */
+    uint64_t allOr = 0, allAnd = UINT64_MAX;
+    for(int64_t i=0; i<edgeNumber; i++) {
+        allOr |= greedyEdges[i].key;
+        allAnd &= greedyEdges[i].key;
+    }
+    int64_t counts[256];
+    for(int64_t shift=0; shift<64; shift += 8) {
+        if((((allOr ^ allAnd) >> shift) & 0xFF) == 0) {
+            continue;
+        }
+        memset(counts, 0, sizeof(counts));
+        for(int64_t i=0; i<edgeNumber; i++) {
+            counts[(greedyEdges[i].key >> shift) & 0xFF]++;
+        }
+        int64_t total = 0;
+        for(int64_t j=0; j<256; j++) {
+            int64_t count = counts[j];
+            counts[j] = total;
+            total += count;
+        }
+        for(int64_t i=0; i<edgeNumber; i++) {
+            buffer[counts[(greedyEdges[i].key >> shift) & 0xFF]++] = greedyEdges[i];
+        }
+        greedyEdge *swap = greedyEdges;
+        greedyEdges = buffer;
+        buffer = swap;
+    }
+    return greedyEdges;
 }
 
 stList *chooseMatching_greedy(stList *edges, int64_t nodeNumber) {
     /*
-     * Greedily picks the edge from the list such that each node has at most one edge.
+     * Greedily picks the edge from the list such that each node has at most one edge, in descending order of weight,
+     * breaking ties by position in the list.
      */
-    //First clone the list..
-    edges = stList_copy(edges, NULL);
+    int64_t edgeNumber = stList_length(edges);
+    greedyEdge *greedyEdges = st_malloc(sizeof(greedyEdge) * (edgeNumber + 1));
+    greedyEdge *buffer = st_malloc(sizeof(greedyEdge) * (edgeNumber + 1));
+    for(int64_t i=0; i<edgeNumber; i++) {
+        stIntTuple *edge = stList_get(edges, i);
+        greedyEdge *gE = &greedyEdges[i];
+        //Flipping the sign bit orders signed weights as unsigned keys, inverting the bits makes the order descending.
+        gE->key = ~((uint64_t)stIntTuple_get(edge, 2) ^ ((uint64_t)1 << 63));
+        gE->from = stIntTuple_get(edge, 0);
+        gE->to = stIntTuple_get(edge, 1);
+        gE->index = i;
+        assert(gE->from >= 0 && gE->from < nodeNumber);
+        assert(gE->to >= 0 && gE->to < nodeNumber);
+    }
+    greedyEdge *sortedEdges = radixSortGreedyEdges(greedyEdges, buffer, edgeNumber);
 
-    stSortedSet *seen = getEmptyNodeOrEdgeSetWithCleanup();
+    //A bit per node, set once the node is matched.
+    uint64_t *seen = st_calloc(nodeNumber / 64 + 1, sizeof(uint64_t));
     stList *matching = stList_construct();
-
-    //Sort the adjacency pairs..
-    stList_sort(edges, chooseMatching_greedyP);
-
-    double strength = INT64_MAX;
-    while (stList_length(edges) > 0) {
-        stIntTuple *edge = stList_pop(edges);
-        double d = stIntTuple_get(edge, 2);
-        assert(d <= strength);
-        strength = d;
-        if(!nodeInSet(seen, stIntTuple_get(edge, 0)) && !nodeInSet(seen, stIntTuple_get(edge, 1))) {
-            addNodeToSet(seen, stIntTuple_get(edge, 0));
-            addNodeToSet(seen, stIntTuple_get(edge, 1));
-            stList_append(matching,edge);
+    for(int64_t i=0; i<edgeNumber; i++) {
+        greedyEdge *gE = &sortedEdges[i];
+        assert(i == 0 || sortedEdges[i-1].key <= gE->key);
+        uint64_t fromBit = (uint64_t)1 << (gE->from & 63), toBit = (uint64_t)1 << (gE->to & 63);
+        if(!(seen[gE->from >> 6] & fromBit) && !(seen[gE->to >> 6] & toBit)) {
+            seen[gE->from >> 6] |= fromBit;
+            seen[gE->to >> 6] |= toBit;
+            stList_append(matching, stList_get(edges, gE->index));
         }
     }
-    assert(stList_length(edges) == 0);
-    stList_destruct(edges);
-    stSortedSet_destruct(seen);
+    free(seen);
+    free(greedyEdges);
+    free(buffer);
 
     return matching;
 }
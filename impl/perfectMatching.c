@@ -4,49 +4,103 @@
 #include "stMatchingAlgorithms.h"
 #include "shared.h"
 
-static void makeMatchingPerfect(stList *chosenEdges, stList *adjacencyEdges,
-        stSortedSet *nodes) {
+static packedEdge *makeMatchingPerfect(packedEdge *chosenEdges, int64_t chosenNumber, stSortedSet *nodes,
+        edgeIndex *adjacencyEdgesIndex, int64_t *matchingLength) {
     /*
-     * While the the number of edges is less than a perfect matching add random edges.
+     * While the the number of edges is less than a perfect matching add random edges. Pairs of nodes without an
+     * adjacency edge are joined by a zero weight edge with index -1.
      */
-    stSortedSet *attachedNodes = getNodeSetOfEdges(chosenEdges);
-    stHash *nodesToAdjacencyEdges = getNodesToEdgesHash(adjacencyEdges);
-    stIntTuple *pNode = NULL;
-    stSortedSetIterator *it = stSortedSet_getIterator(nodes);
-    stIntTuple *node;
-    while((node = stSortedSet_getNext(it)) != NULL) {
-        if (stSortedSet_search(attachedNodes, node) == NULL) {
-            if (pNode == NULL) {
-                pNode = node;
+    int64_t nodeNumber = stSortedSet_size(nodes);
+    int64_t *nodeArray = getNodeArray(nodes);
+    bool *attachedNodes = st_calloc(nodeNumber + 1, sizeof(bool));
+    for (int64_t i = 0; i < chosenNumber; i++) {
+        attachedNodes[getNodeIndex(nodeArray, nodeNumber, chosenEdges[i].node1)] = 1;
+        attachedNodes[getNodeIndex(nodeArray, nodeNumber, chosenEdges[i].node2)] = 1;
+    }
+    packedEdge *matching = st_malloc(sizeof(packedEdge) * (nodeNumber / 2 + 1));
+    memcpy(matching, chosenEdges, sizeof(packedEdge) * chosenNumber);
+    *matchingLength = chosenNumber;
+    int64_t pNode = -1;
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        if (!attachedNodes[i]) {
+            if (pNode == -1) {
+                pNode = i;
             } else {
-                stList_append(chosenEdges,
-                        getEdgeForNodes(stIntTuple_get(pNode, 0), stIntTuple_get(node, 0), nodesToAdjacencyEdges));
-                pNode = NULL;
+                packedEdge *edge = edgeIndex_getEdge(adjacencyEdgesIndex, nodeArray[pNode], nodeArray[i]);
+                packedEdge *matchedEdge = &matching[(*matchingLength)++];
+                if (edge != NULL) {
+                    *matchedEdge = *edge;
+                } else {
+                    matchedEdge->node1 = nodeArray[pNode];
+                    matchedEdge->node2 = nodeArray[i];
+                    matchedEdge->weight = 0;
+                    matchedEdge->index = -1;
+                }
+                pNode = -1;
             }
         }
     }
-    stSortedSet_destructIterator(it);
-    assert(pNode == NULL);
-    stSortedSet_destruct(attachedNodes);
-    assert(stList_length(chosenEdges) * 2 == stSortedSet_size(nodes));
-    stHash_destruct(nodesToAdjacencyEdges);
+    assert(pNode == -1);
+    assert(*matchingLength * 2 == nodeNumber);
+    free(attachedNodes);
+    free(nodeArray);
+    return matching;
 }
 
-stList *getPerfectMatching(stSortedSet *nodes,
-        stList *adjacencyEdges,
-        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber)) {
-
-    checkEdges(adjacencyEdges, nodes, 1, 1); //Checks edges are clique
-
-    if (stSortedSet_size(nodes) == 0) { //Some of the following functions assume there are at least 2 nodes.
-        return stList_construct();
+packedEdge *getPerfectMatchingOfPackedEdges(stSortedSet *nodes, packedEdge *adjacencyEdges, int64_t adjacencyEdgeNumber,
+        edgeIndex *adjacencyEdgesIndex, stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber),
+        int64_t *matchingLength) {
+    /*
+     * Match the edges with positive weight, which keep the index of the adjacency edge, then pair the remaining nodes.
+     */
+    packedEdge *nonZeroWeightAdjacencyEdges = st_malloc(sizeof(packedEdge) * (adjacencyEdgeNumber + 1));
+    int64_t nonZeroWeightAdjacencyEdgeNumber = 0;
+    for (int64_t i = 0; i < adjacencyEdgeNumber; i++) {
+        if (adjacencyEdges[i].weight > 0) {
+            nonZeroWeightAdjacencyEdges[nonZeroWeightAdjacencyEdgeNumber++] = adjacencyEdges[i];
+        }
     }
+    int64_t chosenNumber;
+    int64_t *chosenEdgeIndices = getSparseMatchingOfPackedEdges(nodes, nonZeroWeightAdjacencyEdges,
+            nonZeroWeightAdjacencyEdgeNumber, matchingAlgorithm, &chosenNumber);
+    packedEdge *chosenEdges = st_malloc(sizeof(packedEdge) * (chosenNumber + 1));
+    for (int64_t i = 0; i < chosenNumber; i++) {
+        chosenEdges[i] = nonZeroWeightAdjacencyEdges[chosenEdgeIndices[i]];
+    }
+    packedEdge *matching = makeMatchingPerfect(chosenEdges, chosenNumber, nodes, adjacencyEdgesIndex, matchingLength);
+    free(chosenEdges);
+    free(chosenEdgeIndices);
+    free(nonZeroWeightAdjacencyEdges);
+    return matching;
+}
 
-    stList *nonZeroWeightAdjacencyEdges = getEdgesWithGreaterThanZeroWeight(
-                adjacencyEdges);
-    stList *chosenEdges = getSparseMatching(nodes, nonZeroWeightAdjacencyEdges, matchingAlgorithm);
-    stList_destruct(nonZeroWeightAdjacencyEdges);
-    makeMatchingPerfect(chosenEdges, adjacencyEdges, nodes);
+static stList *getPerfectMatchingP(stSortedSet *nodes,
+        stList *adjacencyEdges,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), stList *zeroWeightEdges) {
+    /*
+     * Computes the matching of the packed edges. If zeroWeightEdges is not NULL, the zero weight edges made to join
+     * pairs of nodes without an adjacency edge are appended to it.
+     */
+    packedEdge *edges = getPackedEdges(adjacencyEdges);
+    edgeIndex *adjacencyEdgesIndex = edgeIndex_construct(edges, stList_length(adjacencyEdges));
+    int64_t matchingLength;
+    packedEdge *matching = getPerfectMatchingOfPackedEdges(nodes, edges, stList_length(adjacencyEdges),
+            adjacencyEdgesIndex, matchingAlgorithm, &matchingLength);
+    stList *chosenEdges = stList_construct2(matchingLength);
+    for (int64_t i = 0; i < matchingLength; i++) {
+        stIntTuple *edge;
+        if (matching[i].index == -1) {
+            assert(zeroWeightEdges != NULL);
+            edge = constructWeightedEdge(matching[i].node1, matching[i].node2, 0);
+            stList_append(zeroWeightEdges, edge);
+        } else {
+            edge = stList_get(adjacencyEdges, matching[i].index);
+        }
+        stList_set(chosenEdges, i, edge);
+    }
+    free(matching);
+    edgeIndex_destruct(adjacencyEdgesIndex);
+    free(edges);
 
     st_logDebug(
                 "Chosen a perfect matching with %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
@@ -55,3 +109,22 @@ stList *getPerfectMatching(stSortedSet *nodes,
 
     return chosenEdges;
 }
+
+stList *getPerfectMatching(stSortedSet *nodes,
+        stList *adjacencyEdges,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber)) {
+
+    checkEdges(adjacencyEdges, nodes, 1, 1); //Checks edges are clique
+
+    return getPerfectMatchingP(nodes, adjacencyEdges, matchingAlgorithm, NULL);
+}
+
+stList *getPerfectMatching2(stSortedSet *nodes,
+        stList *adjacencyEdges,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), stList **zeroWeightEdges) {
+
+    checkEdges(adjacencyEdges, nodes, 0, 0); //The edges need not be a clique, or cover the nodes
+
+    *zeroWeightEdges = stList_construct3(0, (void (*)(void *)) stIntTuple_destruct);
+    return getPerfectMatchingP(nodes, adjacencyEdges, matchingAlgorithm, *zeroWeightEdges);
+}
@@ -251,6 +251,7 @@ typedef struct _referenceTerm referenceTerm;
 
 struct _referenceTerm {
     referenceTerm *first, *pTerm, *nTerm;
+    referenceTerm *last; //Only kept up to date for the first term of each interval.
     int64_t node;
     int64_t index;
 };
@@ -258,14 +259,18 @@ struct _referenceTerm {
 struct _reference {
     int64_t nodeNumber;
     referenceTerm **nodesInGraph;
+    bool *removeInterval; //Flags indexed like nodesInGraph, used to remove intervals and cleared again after each use.
     stList *referenceIntervals;
+    int64_t maxNode; //The largest absolute node value ever added, new stubs are numbered from above it.
 };
 
 refOrdering *reference_construct(int64_t estimatedNodeNumber) {
     refOrdering *ref = st_malloc(sizeof(refOrdering));
     ref->nodeNumber = estimatedNodeNumber;
     ref->nodesInGraph = st_calloc(estimatedNodeNumber, sizeof(referenceTerm *));
+    ref->removeInterval = st_calloc(estimatedNodeNumber, sizeof(bool));
     ref->referenceIntervals = stList_construct();
+    ref->maxNode = 0;
     return ref;
 }
 
@@ -276,6 +281,7 @@ void reference_destruct(refOrdering *ref) {
         }
     }
     free(ref->nodesInGraph);
+    free(ref->removeInterval);
     stList_destruct(ref->referenceIntervals);
     free(ref);
 }
@@ -290,13 +296,18 @@ void reference_insertNodeP(refOrdering *ref, referenceTerm *rT) {
     while(llabs(rT->node) > ref->nodeNumber) { //Expand array if necessary.
         int64_t newNodeNumber = 2 * ref->nodeNumber + 1;
         ref->nodesInGraph = st_realloc(ref->nodesInGraph, newNodeNumber * sizeof(referenceTerm *));
+        ref->removeInterval = st_realloc(ref->removeInterval, newNodeNumber * sizeof(bool));
         for(int64_t i=ref->nodeNumber; i<newNodeNumber; i++) {
             ref->nodesInGraph[i] = NULL;
+            ref->removeInterval[i] = 0;
         }
         ref->nodeNumber = newNodeNumber;
     }
     assert(reference_getTerm(ref, rT->node) == NULL);
     ref->nodesInGraph[llabs(rT->node)-1] = rT;
+    if(llabs(rT->node) > ref->maxNode) {
+        ref->maxNode = llabs(rT->node);
+    }
 }
 
 void reference_makeNewInterval(refOrdering *ref, int64_t firstNode, int64_t lastNode) {
@@ -311,6 +322,7 @@ void reference_makeNewInterval(refOrdering *ref, int64_t firstNode, int64_t last
     rTL->nTerm = NULL;
     rTF->first = rTF;
     rTL->first = rTF;
+    rTF->last = rTL;
     rTF->index = 0;
     rTL->index = INT64_MAX; //This forces the rebalancing code to be exercised.
     reference_insertNodeP(ref, rTF);
@@ -318,18 +330,22 @@ void reference_makeNewInterval(refOrdering *ref, int64_t firstNode, int64_t last
     stList_append(ref->referenceIntervals, rTF);
 }
 
-void reference_removeIntervals(refOrdering *ref, stSortedSet *firstNodesOfIntervalsToRemove) {
+static void reference_removeIntervalsP(refOrdering *ref) {
+    /*
+     * Removes the intervals whose first node n has ref->removeInterval[llabs(n)-1] set, resetting the flags of those removed.
+     * Only the first nodes of intervals may be flagged, so that all the flags are clear afterwards.
+     */
+    bool *removeInterval = ref->removeInterval;
     stList *updatedReferenceIntervals = stList_construct();
     for(int64_t i=0;i<stList_length(ref->referenceIntervals); i++) {
-        int64_t node = reference_getFirstOfInterval(ref, i);
-        referenceTerm *rT = reference_getTerm(ref, node);
+        referenceTerm *rT = stList_get(ref->referenceIntervals, i);
         assert(rT != NULL);
-        stIntTuple *j = stIntTuple_construct1(node);
-        if(stSortedSet_search(firstNodesOfIntervalsToRemove, j) == NULL) { //It is not in the list of intervals to delete,
+        if(!removeInterval[llabs(rT->node)-1]) { //It is not in the list of intervals to delete,
             //so we add it to the list of intervals to keep
-            stList_append(updatedReferenceIntervals, reference_getTerm(ref, node));
+            stList_append(updatedReferenceIntervals, rT);
         }
         else {
+            removeInterval[llabs(rT->node)-1] = 0;
             //Release the term from the node array
             assert(rT->pTerm == NULL);
             while(rT != NULL) {
@@ -340,12 +356,25 @@ void reference_removeIntervals(refOrdering *ref, stSortedSet *firstNodesOfInterv
                 free(rTP);
            }
         }
-        stIntTuple_destruct(j);
     }
     stList_destruct(ref->referenceIntervals);
     ref->referenceIntervals = updatedReferenceIntervals;
 }
 
+void reference_removeIntervals(refOrdering *ref, stSortedSet *firstNodesOfIntervalsToRemove) {
+    stSortedSetIterator *it = stSortedSet_getIterator(firstNodesOfIntervalsToRemove);
+    stIntTuple *j;
+    while((j = stSortedSet_getNext(it)) != NULL) {
+        int64_t node = stIntTuple_get(j, 0);
+        referenceTerm *rT = reference_inGraph(ref, node) ? reference_getTerm(ref, node) : NULL;
+        if(rT != NULL && rT->node == node && rT->first == rT) {
+            ref->removeInterval[llabs(node)-1] = 1;
+        }
+    }
+    stSortedSet_destructIterator(it);
+    reference_removeIntervalsP(ref);
+}
+
 void reference_insertNode(refOrdering *ref, int64_t pNode, int64_t node) {
     referenceTerm *rT = st_malloc(sizeof(referenceTerm)), *rTP;
     rT->node = node;
@@ -402,6 +431,49 @@ static void reference_removeNode(refOrdering *ref, int64_t n) {
     free(rT);
 }
 
+static void reference_replaceIntervalContentsP(refOrdering *ref, int64_t firstNode, int64_t *orderedNodes, int64_t length) {
+    referenceTerm *rTF = reference_getTerm(ref, firstNode);
+    assert(rTF != NULL);
+    assert(rTF->first == rTF);
+    //Release the existing inner terms
+    referenceTerm *rT = rTF->nTerm;
+    assert(rT != NULL);
+    while (rT->nTerm != NULL) {
+        ref->nodesInGraph[llabs(rT->node)-1] = NULL;
+        referenceTerm *rTN = rT->nTerm;
+        free(rT);
+        rT = rTN;
+    }
+    referenceTerm *rTL = rT;
+    //Link in the new terms, giving every term in the interval equi-distant labels
+    int64_t spacer = INT64_MAX / (length + 1);
+    assert(spacer > 0);
+    rTF->index = 0;
+    referenceTerm *rTP = rTF;
+    for (int64_t i = 0; i < length; i++) {
+        rT = st_malloc(sizeof(referenceTerm));
+        rT->node = orderedNodes[i];
+        rT->first = rTF;
+        rT->pTerm = rTP;
+        rTP->nTerm = rT;
+        rT->index = rTP->index + spacer;
+        reference_insertNodeP(ref, rT);
+        rTP = rT;
+    }
+    rTP->nTerm = rTL;
+    rTL->pTerm = rTP;
+    rTL->index = rTP->index + spacer;
+}
+
+void reference_replaceIntervalContents(refOrdering *ref, int64_t firstNode, stList *orderedNodes) {
+    int64_t *nodes = st_malloc(sizeof(int64_t) * stList_length(orderedNodes));
+    for (int64_t i = 0; i < stList_length(orderedNodes); i++) {
+        nodes[i] = stIntTuple_get(stList_get(orderedNodes, i), 0);
+    }
+    reference_replaceIntervalContentsP(ref, firstNode, nodes, stList_length(orderedNodes));
+    free(nodes);
+}
+
 bool reference_inGraph(refOrdering *ref, int64_t n) {
     return llabs(n) <= ref->nodeNumber && reference_getTerm(ref, n) != NULL;
 }
@@ -438,10 +510,9 @@ int64_t reference_getNext(refOrdering *ref, int64_t n) {
 
 int64_t reference_getLast(refOrdering *ref, int64_t n) {
     assert(reference_inGraph(ref, n));
-    while (reference_getNext(ref, n) != INT64_MAX) {
-        n = reference_getNext(ref, n);
-    }
-    return n;
+    referenceTerm *rTL = reference_getTerm(ref, n)->first->last;
+    assert(rTL->nTerm == NULL);
+    return rTL->node;
 }
 
 bool reference_isConsistent(refOrdering *ref, int64_t m, int64_t n) {
@@ -514,6 +585,10 @@ void reference_translocateIntervals(refOrdering *ref, int64_t pNode1, int64_t nN
     assert(nNode2Term->first == pNode2Term->first);
     setFirstPointer(nNode1Term, pNode2Term->first);
     setFirstPointer(nNode2Term, pNode1Term->first);
+    //Swap the ends of the intervals
+    referenceTerm *lastTerm = pNode1Term->first->last;
+    pNode1Term->first->last = pNode2Term->first->last;
+    pNode2Term->first->last = lastTerm;
 }
 
 void reference_splitInterval(refOrdering *ref, int64_t pNode, int64_t stub1, int64_t stub2) {
@@ -525,6 +600,66 @@ void reference_splitInterval(refOrdering *ref, int64_t pNode, int64_t stub1, int
     reference_translocateIntervals(ref, pNode, stub1);
 }
 
+static void reference_splitIntervalAtNodesP(refOrdering *ref, int64_t *pNodes, int64_t splitNumber, stList *newStubs) {
+    /*
+     * Makes the splits of reference_splitInterval after each of the given nodes, which are in order within one interval, walking
+     * each new interval once to set its first pointers. The new stubs are allocated from the reference's node counter.
+     */
+    referenceTerm *firstTerm = splitNumber > 0 ? reference_getTerm(ref, pNodes[0])->first : NULL;
+    for (int64_t i = 0; i < splitNumber; i++) {
+        referenceTerm *rT = reference_getTerm(ref, pNodes[i]);
+        assert(rT != NULL);
+        assert(rT->first == firstTerm); //The split points are in order and in one interval
+        assert(rT->nTerm != NULL);
+        int64_t stub1 = ref->maxNode + 1;
+        int64_t stub2 = ref->maxNode + 2;
+        assert(stub2 < INT64_MAX);
+        //Make the stubs, stub1 ends the existing interval, stub2 starts the new interval
+        referenceTerm *rTS1 = st_malloc(sizeof(referenceTerm)), *rTS2 = st_malloc(sizeof(referenceTerm));
+        rTS1->node = stub1;
+        rTS2->node = stub2;
+        rTS2->nTerm = rT->nTerm;
+        rT->nTerm->pTerm = rTS2;
+        rT->nTerm = rTS1;
+        rTS1->pTerm = rT;
+        rTS1->nTerm = NULL;
+        rTS2->pTerm = NULL;
+        rTS1->first = firstTerm;
+        rTS2->first = rTS2;
+        rTS2->last = firstTerm->last;
+        firstTerm->last = rTS1;
+        rTS1->index = INT64_MAX;
+        rTS2->index = 0;
+        reference_insertNodeP(ref, rTS1);
+        reference_insertNodeP(ref, rTS2);
+        stList_append(ref->referenceIntervals, rTS2);
+        stList_append(newStubs, stIntTuple_construct1(stub1));
+        stList_append(newStubs, stIntTuple_construct1(-stub2)); //Invert the sign, because we use signs to refer to sides of a node
+        //Correct the first pointers up to the next split point
+        firstTerm = rTS2;
+        referenceTerm *rTE = i + 1 < splitNumber ? reference_getTerm(ref, pNodes[i + 1]) : NULL;
+        rT = rTS2->nTerm;
+        while (rT != NULL) {
+            rT->first = firstTerm;
+            if (rT == rTE) {
+                break;
+            }
+            rT = rT->nTerm;
+        }
+    }
+}
+
+stList *reference_splitIntervalAtNodes(refOrdering *ref, stList *pNodes) {
+    stList *newStubs = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    int64_t *nodes = st_malloc(sizeof(int64_t) * stList_length(pNodes));
+    for (int64_t i = 0; i < stList_length(pNodes); i++) {
+        nodes[i] = stIntTuple_get(stList_get(pNodes, i), 0);
+    }
+    reference_splitIntervalAtNodesP(ref, nodes, stList_length(pNodes), newStubs);
+    free(nodes);
+    return newStubs;
+}
+
 /*
  * Returns the integer value of the absolute highest valued node in the reference.
  */
@@ -989,158 +1124,252 @@ int64_t getBadAdjacencyCount(refAdjList *aL, refOrdering *ref) {
     return badAdjacencies;
 }
 
-static stList *getValidEdges(int64_t n, refAdjList *aL, refOrdering *ref) {
+/*
+ * Dense state for the topological reorder. The bitsets are indexed by llabs(node) - 1 and are allocated once for all
+ * the intervals, being reset after each interval by walking the nodes it visited.
+ */
+
+typedef struct _dfsFrame {
+    int64_t node;
+    int64_t edgeStart; //Index of the node's first valid edge in the edge buffer
+    int64_t nextEdge; //Index of the next edge to traverse
+    int64_t edgeEnd;
+} dfsFrame;
+
+typedef struct _dfsState {
+    uint64_t *visiting;
+    uint64_t *visited;
+    refEdge *edges; //Flat buffer holding the valid edges of every node on the stack
+    int64_t edgesLength, edgesMax;
+    dfsFrame *stack;
+    int64_t stackLength, stackMax;
+    int64_t *ordering; //Nodes in the order they are finished
+    int64_t orderingLength, orderingMax;
+} dfsState;
+
+static dfsState *dfsState_construct(refOrdering *ref) {
+    dfsState *dS = st_malloc(sizeof(dfsState));
+    int64_t words = ref->nodeNumber / 64 + 1;
+    dS->visiting = st_calloc(words, sizeof(uint64_t));
+    dS->visited = st_calloc(words, sizeof(uint64_t));
+    dS->edgesLength = 0;
+    dS->edgesMax = 16;
+    dS->edges = st_malloc(dS->edgesMax * sizeof(refEdge));
+    dS->stackLength = 0;
+    dS->stackMax = 16;
+    dS->stack = st_malloc(dS->stackMax * sizeof(dfsFrame));
+    dS->orderingLength = 0;
+    dS->orderingMax = 16;
+    dS->ordering = st_malloc(dS->orderingMax * sizeof(int64_t));
+    return dS;
+}
+
+static void dfsState_destruct(dfsState *dS) {
+    free(dS->visiting);
+    free(dS->visited);
+    free(dS->edges);
+    free(dS->stack);
+    free(dS->ordering);
+    free(dS);
+}
+
+static bool bitSet_get(uint64_t *bits, int64_t i) {
+    return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+static void bitSet_set(uint64_t *bits, int64_t i) {
+    bits[i >> 6] |= ((uint64_t) 1) << (i & 63);
+}
+
+static void bitSet_clear(uint64_t *bits, int64_t i) {
+    bits[i >> 6] &= ~(((uint64_t) 1) << (i & 63));
+}
+
+static void dfsState_reset(dfsState *dS, int64_t n) {
+    bitSet_clear(dS->visiting, llabs(n) - 1);
+    bitSet_clear(dS->visited, llabs(n) - 1);
+}
+
+static void getValidEdges(int64_t n, refAdjList *aL, refOrdering *ref, dfsState *dS) {
     /*
-     * Get edges from n that are consistent with the reference ordering.
+     * Appends the edges from n that are consistent with the reference ordering to the edge buffer.
      */
     assert(!reference_getOrientation(ref, n));
-    stList *validEdges = stList_construct();
     refAdjListIt it = adjList_getEdgeIt(aL, n);
     refEdge e = refAdjListIt_getNext(&it);
     while (refEdge_to(&e) != INT64_MAX) {
-        if(reference_isConsistent(ref, n, refEdge_to(&e))) {
-        //if (reference_cmp(ref, n, refEdge_to(&e)) == -1 && reference_getFirst(ref, n) == reference_getFirst(ref,
-        //        refEdge_to(&e)) && reference_getOrientation(ref, refEdge_to(&e))) {
-            //Is a valid edge
-            stList_append(validEdges, refEdge_copy(&e));
+        if (reference_isConsistent(ref, n, refEdge_to(&e))) { //Is a valid edge
+            if (dS->edgesLength == dS->edgesMax) {
+                dS->edgesMax *= 2;
+                dS->edges = st_realloc(dS->edges, dS->edgesMax * sizeof(refEdge));
+            }
+            dS->edges[dS->edgesLength++] = e;
         }
         e = refAdjListIt_getNext(&it);
     }
     refAdjListIt_destruct(&it);
-    return validEdges;
 }
 
-static bool visitP(int64_t n, stSortedSet *visited, stSortedSet *visiting, refAdjList *aL, refOrdering *ref,
-        stList *ordering, stList *stack) {
+static bool visitP(int64_t n, dfsState *dS, refAdjList *aL, refOrdering *ref) {
     assert(reference_inGraph(ref, n));
-    stIntTuple *i = stIntTuple_construct1(n);
-    if (stSortedSet_search(visited, i) == NULL) {
-        assert(stSortedSet_search(visiting, i) == NULL); //otherwise we have detected a cycle
-        stSortedSet_insert(visiting, i);
-        stList *validEdges = getValidEdges(-n, aL, ref); //The minus sign is because we seek edges incident with the righthand side of the segment.
-        stList_sort(validEdges, (int(*)(const void *, const void *)) refEdge_cmpByWeight);
-        stList_reverse(validEdges); //Traverse edges in reverse order of weight. This should be better, as it will ensure the highest weight adjacency appears in the reference, providing that it can be included in the DFS tree.
-        stList_append(stack, i);
-        stList_append(stack, validEdges);
+    int64_t i = llabs(n) - 1;
+    if (!bitSet_get(dS->visited, i)) {
+        assert(!bitSet_get(dS->visiting, i)); //otherwise we have detected a cycle
+        bitSet_set(dS->visiting, i);
+        if (dS->stackLength == dS->stackMax) {
+            dS->stackMax *= 2;
+            dS->stack = st_realloc(dS->stack, dS->stackMax * sizeof(dfsFrame));
+        }
+        dfsFrame *f = &dS->stack[dS->stackLength++];
+        f->node = n;
+        f->edgeStart = dS->edgesLength;
+        f->nextEdge = dS->edgesLength;
+        getValidEdges(-n, aL, ref, dS); //The minus sign is because we seek edges incident with the righthand side of the segment.
+        f->edgeEnd = dS->edgesLength;
+        //Traverse edges in increasing order of weight, so the highest weight edge is finished last and therefore placed next to n
+        //in the reversed ordering. This should be better, as it will ensure the highest weight adjacency appears in the reference,
+        //providing that it can be included in the DFS tree.
+        qsort(dS->edges + f->edgeStart, f->edgeEnd - f->edgeStart, sizeof(refEdge),
+                (int(*)(const void *, const void *)) refEdge_cmpByWeight);
         return 1;
-    } else {
-        assert(stSortedSet_search(visiting, i) != NULL);
-        stIntTuple_destruct(i);
-        return 0;
     }
+    assert(bitSet_get(dS->visiting, i));
+    return 0;
 }
 
-static void visit(int64_t n, stSortedSet *visited, stSortedSet *visiting, refAdjList *aL, refOrdering *ref,
-        stList *ordering, stList *stack) {
+static void visit(int64_t n, dfsState *dS, refAdjList *aL, refOrdering *ref) {
     /*
      * Do DFS of nodes using edges that are consistent with the graph.
      */
-    if (visitP(n, visited, visiting, aL, ref, ordering, stack)) {
-        while (1) {
-            stList *edges = stList_peek(stack);
-            while (stList_length(edges) > 0) {
-                refEdge *e = stList_pop(edges);
-                int64_t m = e->to;
-                free(e);
-                if (visitP(m, visited, visiting, aL, ref, ordering, stack)) {
-                    goto top;
-                }
+    if (visitP(n, dS, aL, ref)) {
+        while (dS->stackLength > 0) {
+            dfsFrame *f = &dS->stack[dS->stackLength - 1];
+            if (f->nextEdge < f->edgeEnd) {
+                visitP(refEdge_to(&dS->edges[f->nextEdge++]), dS, aL, ref); //May reallocate the stack, so f is not used after.
+                continue;
             }
-            stList_destruct(stList_pop(stack));
-            stIntTuple *i = stList_pop(stack);
-            stSortedSet_insert(visited, i);
-            stList_append(ordering, i);
-            if (stList_length(stack) == 0) {
-                break;
+            dS->edgesLength = f->edgeStart;
+            bitSet_set(dS->visited, llabs(f->node) - 1);
+            if (dS->orderingLength == dS->orderingMax) {
+                dS->orderingMax *= 2;
+                dS->ordering = st_realloc(dS->ordering, dS->orderingMax * sizeof(int64_t));
             }
-            top: ;
+            dS->ordering[dS->orderingLength++] = f->node;
+            dS->stackLength--;
         }
     }
 }
 
-static void reorderReferenceIntervalToAvoidBreakpoints(int64_t startNode, refAdjList *aL, refOrdering *ref) {
+static void reorderReferenceIntervalToAvoidBreakpoints(int64_t startNode, refAdjList *aL, refOrdering *ref, dfsState *dS) {
     /*
      * Create a topological sort of the nodes in the reference interval, choosing to traverse more highly weighted edges first,
      * with the aim of creating fewer edges that are inconsistent.
      */
-    stList *stack = stList_construct();
-    stSortedSet *visited = stSortedSet_construct3((int(*)(const void *, const void *)) stIntTuple_cmpFn, NULL);
-    stSortedSet *visiting = stSortedSet_construct3((int(*)(const void *, const void *)) stIntTuple_cmpFn, NULL);
-    stList *ordering = stList_construct();
-    visit(reference_getLast(ref, startNode), visited, visiting, aL, ref, ordering, stack); //Add last node first, as constructed in reverse order.
-    visit(startNode, visited, visiting, aL, ref, ordering, stack); //Visit the start node first
-    stIntTuple *i = stList_pop(ordering); //Remove the first node, as it must appear first
+    dS->orderingLength = 0;
+    int64_t lastNode = reference_getLast(ref, startNode);
+    visit(lastNode, dS, aL, ref); //Add last node first, as constructed in reverse order.
+    visit(startNode, dS, aL, ref); //Visit the start node first
+    assert(dS->ordering[dS->orderingLength - 1] == startNode);
+    dS->orderingLength--; //Remove the first node, as it must appear first
     int64_t n = startNode;
     while (reference_getNext(ref, n) != INT64_MAX) { //add any other nodes to the ordering that are not on a path from the start node
-        visit(n, visited, visiting, aL, ref, ordering, stack);
+        visit(n, dS, aL, ref);
         n = reference_getNext(ref, n);
     }
-    stSortedSet_destruct(visited);
-    stSortedSet_destruct(visiting);
-    stIntTuple_destruct(i);
-    //Now rebuild the reference
-    n = reference_getNext(ref, startNode); //Remove the old nodes (this doesn't mess with the first and last nodes).
-    while (reference_getNext(ref, n) != INT64_MAX) {
-        int64_t m = reference_getNext(ref, n);
-        reference_removeNode(ref, n);
-        n = m;
+    assert(dS->ordering[0] == lastNode);
+    //Reset the dense state for the next interval
+    dfsState_reset(dS, startNode);
+    for (int64_t j = 0; j < dS->orderingLength; j++) {
+        dfsState_reset(dS, dS->ordering[j]);
     }
-    n = startNode; //Now add back the nodes in the new order
-    assert(reference_getLast(ref, startNode) != INT64_MAX);
-    assert(reference_getLast(ref, startNode) != startNode);
-    assert(reference_getNext(ref, startNode) == reference_getLast(ref, startNode));
-    i = stList_pop(ordering);
-    while (stList_length(ordering) >= 1) {
-        int64_t m = stIntTuple_get(i, 0);
-        assert(!reference_inGraph(ref, m));
-        reference_insertNode(ref, n, m);
-        n = m;
-        stIntTuple_destruct(i);
-        i = stList_pop(ordering);
+    //Now rebuild the reference, with the nodes in reverse finishing order. The last node, at the start of the ordering,
+    //stays in place.
+    for (int64_t j = 1, k = dS->orderingLength - 1; j < k; j++, k--) {
+        int64_t m = dS->ordering[j];
+        dS->ordering[j] = dS->ordering[k];
+        dS->ordering[k] = m;
     }
-    stIntTuple_destruct(i);
-    stList_destruct(ordering);
+    reference_replaceIntervalContentsP(ref, startNode, dS->ordering + 1, dS->orderingLength - 1);
 }
 
 void reorderReferenceToAvoidBreakpoints(refAdjList *aL, refOrdering *ref) {
+    dfsState *dS = dfsState_construct(ref);
     for (int64_t i = 0; i < reference_getIntervalNumber(ref); i++) {
-        reorderReferenceIntervalToAvoidBreakpoints(reference_getFirstOfInterval(ref, i), aL, ref);
+        reorderReferenceIntervalToAvoidBreakpoints(reference_getFirstOfInterval(ref, i), aL, ref, dS);
     }
+    dfsState_destruct(dS);
 }
 
 stList *splitReferenceAtIndicatedLocations(refOrdering *ref, bool (*refSplitFn)(int64_t, refOrdering *, void *), void *extraArgs) {
-	int64_t indexOfFirstNewStub = reference_getMaximumNode(ref)+1; //The new stubs need to be unique in the reference
-	assert(indexOfFirstNewStub < INT64_MAX);
-	assert(!reference_inGraph(ref, indexOfFirstNewStub));
 	stList *newStubs = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+	int64_t pNodesMax = 16;
+	int64_t *pNodes = st_malloc(sizeof(int64_t) * pNodesMax);
 	for(int64_t interval=reference_getIntervalNumber(ref)-1; interval>=0; interval--) { //Iterate over only the old intervals, not those involving new stubs.
+		//Collect the split points of the interval, then make the splits in one pass.
+		int64_t splitNumber = 0;
 		int64_t pNode = reference_getFirstOfInterval(ref, interval);
 		int64_t node = reference_getNext(ref, pNode);
 		while(node != INT64_MAX) {
 			if(refSplitFn(pNode, ref, extraArgs)) { //Determine if a split is needed.
-				int64_t newStub1 = indexOfFirstNewStub++;
-				int64_t newStub2 = indexOfFirstNewStub++;
-				stList_append(newStubs, stIntTuple_construct1(newStub1));
-				stList_append(newStubs, stIntTuple_construct1(-newStub2)); //Invert the sign, because we use signs to refer to sides of a node
-				reference_splitInterval(ref, pNode, newStub1, newStub2);
+				if(splitNumber == pNodesMax) {
+					pNodesMax *= 2;
+					pNodes = st_realloc(pNodes, sizeof(int64_t) * pNodesMax);
+				}
+				pNodes[splitNumber++] = pNode;
 			}
 			pNode = node;
 			node = reference_getNext(ref, pNode);
 		}
+		reference_splitIntervalAtNodesP(ref, pNodes, splitNumber, newStubs);
 	}
+	free(pNodes);
 	return newStubs;
 }
 
-static void removeStub(stSortedSet *extraStubNodesSet, int64_t node) {
-    stIntTuple *stub = stIntTuple_construct1(node);
-    assert(stSortedSet_search(extraStubNodesSet, stub) != NULL);
-    stSortedSet_remove(extraStubNodesSet, stub);
-    stIntTuple_destruct(stub);
+static int compareStubs(const void *a, const void *b) {
+    int64_t i = stIntTuple_get(*(stIntTuple **)a, 0), j = stIntTuple_get(*(stIntTuple **)b, 0);
+    return i < j ? -1 : (i > j ? 1 : 0);
+}
+
+static void removeStub(stIntTuple **stubs, int64_t stubNumber, bool *removedStubs, int64_t node) {
+    /*
+     * Marks the stub as removed, finding it by binary search of the stubs, which are sorted by value.
+     */
+    int64_t i = 0, j = stubNumber;
+    while(i < j) {
+        int64_t k = i + (j - i) / 2;
+        if(stIntTuple_get(stubs[k], 0) < node) {
+            i = k + 1;
+        }
+        else {
+            j = k;
+        }
+    }
+    if(i == stubNumber || stIntTuple_get(stubs[i], 0) != node || removedStubs[i]) {
+        st_errAbort("The stub %" PRIi64 " to remove is not in the list of extra stub nodes\n", node);
+    }
+    removedStubs[i] = 1;
 }
 
 stList *remakeReferenceIntervals(refOrdering *ref, stList *referenceIntervalsToPreserve, stList *extraStubNodes) {
-    stSortedSet *extraStubNodesSet = stList_getSortedSet(extraStubNodes, (int (*)(const void *, const void *))stIntTuple_cmpFn);
-    stSortedSet *firstNodesOfIntervalsToRemove = stSortedSet_construct3((int (*)(const void *, const void *))stIntTuple_cmpFn, (void (*)(void *))stIntTuple_destruct);
+    /*
+     * Works in time proportional to the number of stubs and intervals, except for the walks made by reference_translocateIntervals
+     * to reset the first pointers of each rejoined interval.
+     */
+    int64_t stubNumber = stList_length(extraStubNodes);
+    stIntTuple **stubs = st_malloc(sizeof(stIntTuple *) * (stubNumber + 1));
+    for(int64_t i=0; i<stubNumber; i++) {
+        stubs[i] = stList_get(extraStubNodes, i);
+    }
+    qsort(stubs, stubNumber, sizeof(stIntTuple *), compareStubs);
+    int64_t j = 0; //Remove duplicate stubs, as the sorted set of stubs this replaced did.
+    for(int64_t i=0; i<stubNumber; i++) {
+        if(j == 0 || stIntTuple_get(stubs[j-1], 0) != stIntTuple_get(stubs[i], 0)) {
+            stubs[j++] = stubs[i];
+        }
+    }
+    stubNumber = j;
+    bool *removedStubs = st_calloc(stubNumber + 1, sizeof(bool));
     for(int64_t i=0; i<stList_length(referenceIntervalsToPreserve); i++) {
         stIntTuple *intervalToPreserve = stList_get(referenceIntervalsToPreserve, i);
         int64_t startNode = stIntTuple_get(intervalToPreserve, 0);
@@ -1160,23 +1389,28 @@ stList *remakeReferenceIntervals(refOrdering *ref, stList *referenceIntervalsToP
             assert(reference_getNext(ref, nodeAdjacentEndNode) == nodeAdjacentStartNode);
             assert(reference_getFirst(ref, nodeAdjacentStartNode) == nodeAdjacentEndNode);
             assert(reference_getPrevious(ref, nodeAdjacentStartNode) == nodeAdjacentEndNode);
-            //Append to list of stub intervals to delete.
+            //Mark the stub interval to delete.
             assert(reference_getFirst(ref, nodeAdjacentEndNode) == nodeAdjacentEndNode);
-            stSortedSet_insert(firstNodesOfIntervalsToRemove, stIntTuple_construct1(nodeAdjacentEndNode));
+            ref->removeInterval[llabs(nodeAdjacentEndNode)-1] = 1;
             //Delete the stubs
-            removeStub(extraStubNodesSet, nodeAdjacentStartNode);
-            removeStub(extraStubNodesSet, -nodeAdjacentEndNode); //The minus sign is to refer to the 3' end of the node.
+            removeStub(stubs, stubNumber, removedStubs, nodeAdjacentStartNode);
+            removeStub(stubs, stubNumber, removedStubs, -nodeAdjacentEndNode); //The minus sign is to refer to the 3' end of the node.
         }
         else {
             assert(nodeAdjacentEndNode == startNode);
         }
     }
     //Remove the old stub intervals
-    reference_removeIntervals(ref, firstNodesOfIntervalsToRemove);
-    stSortedSet_destruct(firstNodesOfIntervalsToRemove);
-    //Revise list of extra stub nodes.
-    extraStubNodes = stSortedSet_getList(extraStubNodesSet);
-    stSortedSet_destruct(extraStubNodesSet);
+    reference_removeIntervalsP(ref);
+    //Revise list of extra stub nodes, in sorted order.
+    extraStubNodes = stList_construct();
+    for(int64_t i=0; i<stubNumber; i++) {
+        if(!removedStubs[i]) {
+            stList_append(extraStubNodes, stubs[i]);
+        }
+    }
+    free(removedStubs);
+    free(stubs);
     return extraStubNodes;
 }
 
@@ -1190,6 +1424,72 @@ long double calculateZScore(int64_t n, int64_t m, int64_t k, long double theta)
     return ((1.0 - pow(beta, (long double)n)) / theta) * pow(beta, (long double)k) * ((1.0 - pow(beta, (long double)m)) / theta);
 }
 
+/*
+ * Z-score calculator, tabulating the powers of beta for a fixed theta.
+ */
+
+struct _zScoreCalculator {
+    long double theta;
+    int64_t maxLength;
+    long double *powers; //beta^i, for 0 <= i <= maxLength
+    long double *sums; //(1 - beta^i) / theta, which is i when theta is 0, for 0 <= i <= maxLength
+};
+
+zScoreCalculator *zScoreCalculator_construct(long double theta, int64_t maxLength) {
+    assert(theta <= 1.0);
+    assert(theta >= 0.0);
+    assert(maxLength >= 0);
+    zScoreCalculator *zS = st_malloc(sizeof(zScoreCalculator));
+    zS->theta = theta;
+    zS->maxLength = maxLength;
+    zS->powers = st_malloc(sizeof(long double) * (maxLength + 1));
+    zS->sums = st_malloc(sizeof(long double) * (maxLength + 1));
+    long double beta = 1.0 - theta;
+    zS->powers[0] = 1.0;
+    zS->sums[0] = 0.0;
+    for (int64_t i = 1; i <= maxLength; i++) {
+        //Use the recurrences beta^i = beta * beta^(i-1) and (1 - beta^i)/theta = 1 + beta * (1 - beta^(i-1))/theta,
+        //the latter avoiding the cancellation in 1 - beta^i when theta is small.
+        zS->powers[i] = zS->powers[i - 1] * beta;
+        zS->sums[i] = 1.0 + beta * zS->sums[i - 1];
+    }
+    return zS;
+}
+
+void zScoreCalculator_destruct(zScoreCalculator *zS) {
+    free(zS->powers);
+    free(zS->sums);
+    free(zS);
+}
+
+long double zScoreCalculator_get(zScoreCalculator *zS, int64_t n, int64_t m, int64_t k) {
+    //Compared unsigned so that negative lengths also miss the tables.
+    const uint64_t maxLength = zS->maxLength;
+    if ((uint64_t) n > maxLength || (uint64_t) m > maxLength || (uint64_t) k > maxLength) {
+        return calculateZScore(n, m, k, zS->theta);
+    }
+    return zS->sums[n] * zS->powers[k] * zS->sums[m];
+}
+
+void zScoreCalculator_getBatch(zScoreCalculator *zS, const int64_t *n, const int64_t *m, const int64_t *k, long double *zScores,
+        int64_t length) {
+    const long double *powers = zS->powers, *sums = zS->sums;
+    const uint64_t maxLength = zS->maxLength;
+    //Gather from the tables in a branch free loop, then patch the (rare) entries that fall outside the tables.
+    int64_t outOfRange = 0;
+    for (int64_t i = 0; i < length; i++) {
+        bool inRange = (uint64_t) n[i] <= maxLength && (uint64_t) m[i] <= maxLength && (uint64_t) k[i] <= maxLength;
+        outOfRange += !inRange;
+        zScores[i] = sums[inRange ? n[i] : 0] * powers[inRange ? k[i] : 0] * sums[inRange ? m[i] : 0];
+    }
+    for (int64_t i = 0; outOfRange > 0 && i < length; i++) {
+        if ((uint64_t) n[i] > maxLength || (uint64_t) m[i] > maxLength || (uint64_t) k[i] > maxLength) {
+            zScores[i] = zScoreCalculator_get(zS, n[i], m[i], k[i]);
+            outOfRange--;
+        }
+    }
+}
+
 double exponentiallyDecreasingTemperatureFn(double d) {
     return 1000 * pow(100000, -d);
 }
@@ -1,5 +1,7 @@
 
+#include <stdlib.h>
 #include "sonLib.h"
+#include "shared.h"
 
 /*
  * Miscellaneous basic functions used to deal with nodes and edges in the reference code.
@@ -154,6 +156,170 @@ stIntTuple *getWeightedEdgeFromSet(int64_t node1, int64_t node2,
             && stIntTuple_get(edge2, 1) == node2 ? edge2 : NULL;
 }
 
+static int compareNodes(const void *a, const void *b) {
+    int64_t i = *(const int64_t *) a, j = *(const int64_t *) b;
+    return i < j ? -1 : (i > j ? 1 : 0);
+}
+
+int64_t sortDistinctNodes(int64_t *nodes, int64_t length) {
+    qsort(nodes, length, sizeof(int64_t), compareNodes);
+    int64_t nodeNumber = 0;
+    for (int64_t i = 0; i < length; i++) {
+        if (nodeNumber == 0 || nodes[nodeNumber - 1] != nodes[i]) {
+            nodes[nodeNumber++] = nodes[i];
+        }
+    }
+    return nodeNumber;
+}
+
+int64_t *getDistinctNodesOfEdges(stList *edges, int64_t *nodeNumber) {
+    int64_t edgeNumber = stList_length(edges);
+    int64_t *nodes = st_malloc(sizeof(int64_t) * (2 * edgeNumber + 1));
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        stIntTuple *edge = stList_get(edges, i);
+        nodes[2 * i] = stIntTuple_get(edge, 0);
+        nodes[2 * i + 1] = stIntTuple_get(edge, 1);
+    }
+    *nodeNumber = sortDistinctNodes(nodes, 2 * edgeNumber);
+    return nodes;
+}
+
+int64_t *getDistinctNodesOfPackedEdges(packedEdge *edges, int64_t edgeNumber, int64_t *nodeNumber) {
+    int64_t *nodes = st_malloc(sizeof(int64_t) * (2 * edgeNumber + 1));
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        nodes[2 * i] = edges[i].node1;
+        nodes[2 * i + 1] = edges[i].node2;
+    }
+    *nodeNumber = sortDistinctNodes(nodes, 2 * edgeNumber);
+    return nodes;
+}
+
+int64_t *getNodeArray(stSortedSet *nodes) {
+    int64_t *nodeArray = st_malloc(sizeof(int64_t) * (stSortedSet_size(nodes) + 1));
+    int64_t i = 0;
+    stSortedSetIterator *it = stSortedSet_getIterator(nodes);
+    stIntTuple *node;
+    while ((node = stSortedSet_getNext(it)) != NULL) {
+        nodeArray[i++] = stIntTuple_get(node, 0);
+    }
+    stSortedSet_destructIterator(it);
+    return nodeArray;
+}
+
+int64_t searchNodeIndex(int64_t *nodes, int64_t nodeNumber, int64_t node) {
+    int64_t i = 0, j = nodeNumber;
+    while (i < j) {
+        int64_t k = i + (j - i) / 2;
+        if (nodes[k] < node) {
+            i = k + 1;
+        } else {
+            j = k;
+        }
+    }
+    return i < nodeNumber && nodes[i] == node ? i : -1;
+}
+
+int64_t getNodeIndex(int64_t *nodes, int64_t nodeNumber, int64_t node) {
+    int64_t i = searchNodeIndex(nodes, nodeNumber, node);
+    assert(i != -1);
+    return i;
+}
+
+int64_t findRoot(int64_t *parents, int64_t node) {
+    while (parents[node] != node) {
+        parents[node] = parents[parents[node]]; //Path halving.
+        node = parents[node];
+    }
+    return node;
+}
+
+struct _edgeIndex {
+    packedEdge *edges;
+    int64_t *positions; //Positions of the edges in the array, open addressed, with linear probing, -1 marks an empty slot.
+    uint64_t mask;
+};
+
+static uint64_t edgeIndex_hash(int64_t node1, int64_t node2) {
+    uint64_t h = (uint64_t) node1 * 0x9E3779B97F4A7C15ULL ^ (uint64_t) node2;
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 29);
+}
+
+packedEdge *getPackedEdges2(stList *edges, int64_t firstIndex, bool nonZeroWeightOnly, int64_t *edgeNumber) {
+    packedEdge *packedEdges = st_malloc(sizeof(packedEdge) * (stList_length(edges) + 1));
+    *edgeNumber = 0;
+    for (int64_t i = 0; i < stList_length(edges); i++) {
+        stIntTuple *edge = stList_get(edges, i);
+        int64_t weight = stIntTuple_length(edge) > 2 ? stIntTuple_get(edge, 2) : 0;
+        if (!nonZeroWeightOnly || weight > 0) {
+            packedEdge *packed = &packedEdges[(*edgeNumber)++];
+            packed->node1 = stIntTuple_get(edge, 0);
+            packed->node2 = stIntTuple_get(edge, 1);
+            packed->weight = weight;
+            packed->index = firstIndex + i;
+        }
+    }
+    return packedEdges;
+}
+
+packedEdge *getPackedEdges(stList *edges) {
+    int64_t edgeNumber;
+    return getPackedEdges2(edges, 0, 0, &edgeNumber);
+}
+
+int64_t getOtherNode(const packedEdge *edge, int64_t node) {
+    assert(edge->node1 == node || edge->node2 == node);
+    return edge->node1 == node ? edge->node2 : edge->node1;
+}
+
+edgeIndex *edgeIndex_construct(packedEdge *edges, int64_t edgeNumber) {
+    edgeIndex *index = st_malloc(sizeof(edgeIndex));
+    uint64_t size = 16;
+    while (size < 2 * (uint64_t) edgeNumber) { //Keep the table at most half full.
+        size *= 2;
+    }
+    index->mask = size - 1;
+    index->edges = edges;
+    index->positions = st_malloc(sizeof(int64_t) * size);
+    for (uint64_t i = 0; i < size; i++) {
+        index->positions[i] = -1;
+    }
+    for (int64_t j = 0; j < edgeNumber; j++) {
+        int64_t node1 = edges[j].node1 < edges[j].node2 ? edges[j].node1 : edges[j].node2;
+        int64_t node2 = edges[j].node1 < edges[j].node2 ? edges[j].node2 : edges[j].node1;
+        uint64_t i = edgeIndex_hash(node1, node2) & index->mask;
+        while (index->positions[i] != -1) {
+            i = (i + 1) & index->mask;
+        }
+        index->positions[i] = j;
+    }
+    return index;
+}
+
+void edgeIndex_destruct(edgeIndex *index) {
+    free(index->positions);
+    free(index);
+}
+
+packedEdge *edgeIndex_getEdge(edgeIndex *index, int64_t node1, int64_t node2) {
+    if (node1 > node2) {
+        int64_t node = node1;
+        node1 = node2;
+        node2 = node;
+    }
+    uint64_t i = edgeIndex_hash(node1, node2) & index->mask;
+    int64_t j;
+    while ((j = index->positions[i]) != -1) {
+        packedEdge *edge = &index->edges[j];
+        if ((edge->node1 == node1 && edge->node2 == node2) || (edge->node1 == node2 && edge->node2 == node1)) {
+            return edge;
+        }
+        i = (i + 1) & index->mask;
+    }
+    return NULL;
+}
+
 static void getNodesToEdgesHashP(stHash *nodesToEdges, stIntTuple *edge,
         int64_t position) {
     stIntTuple *node = stIntTuple_construct1(
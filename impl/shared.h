@@ -41,6 +41,109 @@ void addWeightedEdgeToList(int64_t node1, int64_t node2, int64_t weight,
 stIntTuple *getWeightedEdgeFromSet(int64_t node1, int64_t node2,
         stSortedSet *allAdjacencyEdges);
 
+/*
+ * An edge packed by value, so that the algorithms can store edges contiguously in arrays. Lists of stIntTuple edges
+ * remain the interface of the library: edges are packed on the way in, and results refer back to the tuples by
+ * index, the position of the tuple in the list it was packed from, or -1 for an edge made by the algorithms.
+ */
+typedef struct _packedEdge {
+    int64_t node1;
+    int64_t node2;
+    int64_t weight;
+    int64_t index;
+} packedEdge;
+
+/*
+ * Returns an array of the edges of the list, packed in the same order, each with its position in the list as its index.
+ * Edges of length 2 are given weight zero.
+ */
+packedEdge *getPackedEdges(stList *edges);
+
+/*
+ * As getPackedEdges, adding firstIndex to the index of each edge, and only packing the edges with positive weight if
+ * nonZeroWeightOnly is non-zero. Sets edgeNumber to the number of edges packed.
+ */
+packedEdge *getPackedEdges2(stList *edges, int64_t firstIndex, bool nonZeroWeightOnly, int64_t *edgeNumber);
+
+/*
+ * Returns the node of the packed edge that is not the given node.
+ */
+int64_t getOtherNode(const packedEdge *edge, int64_t node);
+
+/*
+ * Sorts the array of nodes and removes duplicates, returning the number of distinct nodes, which are left at the start of the array.
+ */
+int64_t sortDistinctNodes(int64_t *nodes, int64_t length);
+
+/*
+ * Returns a sorted array of the distinct nodes of the edges, setting nodeNumber to its length.
+ */
+int64_t *getDistinctNodesOfEdges(stList *edges, int64_t *nodeNumber);
+
+/*
+ * As getDistinctNodesOfEdges, for an array of packed edges.
+ */
+int64_t *getDistinctNodesOfPackedEdges(packedEdge *edges, int64_t edgeNumber, int64_t *nodeNumber);
+
+/*
+ * Returns a sorted array of the nodes of the set, which is of tuples of length one.
+ */
+int64_t *getNodeArray(stSortedSet *nodes);
+
+/*
+ * Binary search for the node in a sorted array of distinct nodes, returning its index, or -1 if it is not present.
+ */
+int64_t searchNodeIndex(int64_t *nodes, int64_t nodeNumber, int64_t node);
+
+/*
+ * As searchNodeIndex, for a node that must be present.
+ */
+int64_t getNodeIndex(int64_t *nodes, int64_t nodeNumber, int64_t node);
+
+/*
+ * Finds the root of the node in a union-find forest, where parents[i] is the parent of i, halving the path as it goes.
+ */
+int64_t findRoot(int64_t *parents, int64_t node);
+
+/*
+ * A hash table of an array of packed edges by their pair of nodes, which holds the positions of the edges in the array,
+ * so edges can be found without allocating a probe tuple. The array is not owned by the index, and must outlive it.
+ * If two edges join the same nodes the first in the array is found.
+ */
+typedef struct _edgeIndex edgeIndex;
+
+edgeIndex *edgeIndex_construct(packedEdge *edges, int64_t edgeNumber);
+
+void edgeIndex_destruct(edgeIndex *index);
+
+/*
+ * Returns the edge of the array between the two nodes, in either order, or NULL if there is none.
+ */
+packedEdge *edgeIndex_getEdge(edgeIndex *index, int64_t node1, int64_t node2);
+
+/*
+ * As getSparseMatching, for an array of packed edges. Returns the positions in the array of the chosen edges, in the
+ * order the matching algorithm chose them, and sets chosenNumber to their number.
+ */
+int64_t *getSparseMatchingOfPackedEdges(stSortedSet *nodes, packedEdge *edges, int64_t edgeNumber,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t *chosenNumber);
+
+/*
+ * As getPerfectMatching2, for an array of packed adjacency edges and an index of them. Returns the matching as an array
+ * of packed edges, setting matchingLength to its length. A pair of nodes without an adjacency edge is joined by a zero
+ * weight edge with index -1.
+ */
+packedEdge *getPerfectMatchingOfPackedEdges(stSortedSet *nodes, packedEdge *adjacencyEdges, int64_t adjacencyEdgeNumber,
+        edgeIndex *adjacencyEdgesIndex, stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber),
+        int64_t *matchingLength);
+
+/*
+ * Computes a maximum weight matching with the Edmonds blossom algorithm in 64 bit integers, in O(n^3) time, for weights
+ * too large for blossom5. If maximumCardinality is non-zero the matching is of maximum weight among those of maximum
+ * cardinality. Returns the matched edges of the list, in the order of the list.
+ */
+stList *chooseMatching_edmonds(stList *edges, int64_t nodeNumber, bool maximumCardinality);
+
 stHash *getNodesToEdgesHash(stList *edges);
 
 stIntTuple *getEdgeForNodes(int64_t node1, int64_t node2,
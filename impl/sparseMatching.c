@@ -1,61 +1,145 @@
+#include <pthread.h>
 #include "sonLib.h"
 #include "stCheckEdges.h"
 #include "shared.h"
 #include "stMatchingAlgorithms.h"
 
-static stHash *rebaseNodes(stSortedSet *nodes) {
+/*
+ * The nodes renumbered from 0 contiguously, in ascending order.
+ */
+
+typedef struct _rebasedNodes {
+    int64_t nodeNumber;
+    int64_t *nodes; //The nodes in ascending order, the rebased node of nodes[i] is i.
+    int64_t *denseRebasedNodes; //If not NULL, the rebased node of node n is denseRebasedNodes[n - nodes[0]].
+} rebasedNodes;
+
+static rebasedNodes *rebaseNodes(stSortedSet *nodes) {
     /*
-     * Renumber the nodes from 0 contiguously.
+     * If the nodes are compact, so their range is at most a small multiple of their number, makes a table to look up the rebased
+     * node of each node, otherwise rebased nodes are found by binary search.
      */
-    stHash *nodesToRebasedNodes = stHash_construct3(
-            (uint64_t(*)(const void *)) stIntTuple_hashKey,
-            (int(*)(const void *, const void *)) stIntTuple_equalsFn,
-            NULL,
-            (void(*)(void *)) stIntTuple_destruct);
-    int64_t i=0;
-    stSortedSetIterator *it = stSortedSet_getIterator(nodes);
-    stIntTuple *node;
-    while((node = stSortedSet_getNext(it)) != NULL) {
-        stHash_insert(nodesToRebasedNodes, node, stIntTuple_construct1( i++));
-    }
-    stSortedSet_destructIterator(it);
-    return nodesToRebasedNodes;
-}
-
-static stList *translateEdges(stList *edges, stHash *nodesToRebasedNodes) {
+    rebasedNodes *rN = st_malloc(sizeof(rebasedNodes));
+    rN->nodeNumber = stSortedSet_size(nodes);
+    rN->nodes = getNodeArray(nodes);
+    rN->denseRebasedNodes = NULL;
+    if(rN->nodeNumber > 0 && rN->nodes[rN->nodeNumber - 1] - rN->nodes[0] < 4 * rN->nodeNumber) {
+        rN->denseRebasedNodes = st_malloc(sizeof(int64_t) * (rN->nodes[rN->nodeNumber - 1] - rN->nodes[0] + 1));
+        for(int64_t i=0; i<rN->nodeNumber; i++) {
+            rN->denseRebasedNodes[rN->nodes[i] - rN->nodes[0]] = i;
+        }
+    }
+    return rN;
+}
+
+static void rebasedNodes_destruct(rebasedNodes *rN) {
+    free(rN->nodes);
+    free(rN->denseRebasedNodes);
+    free(rN);
+}
+
+static int64_t rebasedNodes_get(rebasedNodes *rN, int64_t node) {
+    if(rN->denseRebasedNodes != NULL) {
+        assert(node >= rN->nodes[0] && node <= rN->nodes[rN->nodeNumber - 1]);
+        return rN->denseRebasedNodes[node - rN->nodes[0]];
+    }
+    return getNodeIndex(rN->nodes, rN->nodeNumber, node);
+}
+
+static packedEdge *translateEdges(packedEdge *edges, int64_t edgeNumber, rebasedNodes *rN) {
     /*
-     * Translate the edges.
+     * Translate the edges. The index of each rebased edge is the position of the edge in the array of edges, so the
+     * matching can be translated back without searching for the edges.
      */
-    stList *rebasedEdges = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
-    for(int64_t i=0; i<stList_length(edges); i++) {
-        stIntTuple *edge = stList_get(edges, i);
-        stIntTuple *node1 = getItemForNode(stIntTuple_get(edge, 0), nodesToRebasedNodes);
-        stIntTuple *node2 = getItemForNode(stIntTuple_get(edge, 1), nodesToRebasedNodes);
-        assert(node1 != NULL);
-        assert(node2 != NULL);
-        stList_append(rebasedEdges, constructWeightedEdge(stIntTuple_get(node1, 0), stIntTuple_get(node2, 0), stIntTuple_get(edge, 2)));
+    packedEdge *rebasedEdges = st_malloc(sizeof(packedEdge) * (edgeNumber + 1));
+    for(int64_t i=0; i<edgeNumber; i++) {
+        int64_t node1 = rebasedNodes_get(rN, edges[i].node1);
+        int64_t node2 = rebasedNodes_get(rN, edges[i].node2);
+        //As for constructWeightedEdge, the smaller node comes first.
+        rebasedEdges[i].node1 = node1 < node2 ? node1 : node2;
+        rebasedEdges[i].node2 = node1 < node2 ? node2 : node1;
+        rebasedEdges[i].weight = edges[i].weight;
+        rebasedEdges[i].index = i;
     }
     return rebasedEdges;
 }
 
-static stList *translateEdges2(stList *rebasedEdges, stHash *rebasedNodesToNodes, stList *originalEdges) {
+static stList *getMatchingAlgorithmEdges(packedEdge *edges, int64_t edgeNumber) {
+    /*
+     * Makes the edges given to the matching algorithm, each (node1, node2, weight, index).
+     */
+    stList *tupleEdges = stList_construct3(edgeNumber, (void (*)(void *))stIntTuple_destruct);
+    for(int64_t i=0; i<edgeNumber; i++) {
+        stList_set(tupleEdges, i, stIntTuple_construct4(edges[i].node1, edges[i].node2, edges[i].weight, edges[i].index));
+    }
+    return tupleEdges;
+}
+
+static int64_t *translateEdges2(stList *chosenEdges, packedEdge *edges, int64_t edgeNumber, int64_t *chosenNumber) {
+    /*
+     * Translate the edges chosen by the matching algorithm back to the indices carried by the edges it was given.
+     * Chosen edges that do not carry an index, because the matching algorithm made its own edges, are found among the
+     * given edges by their nodes.
+     */
+    int64_t *indices = st_malloc(sizeof(int64_t) * (stList_length(chosenEdges) + 1));
+    edgeIndex *edgesIndex = NULL;
+    for(int64_t i=0; i<stList_length(chosenEdges); i++) {
+        stIntTuple *chosenEdge = stList_get(chosenEdges, i);
+        if(stIntTuple_length(chosenEdge) == 4) {
+            indices[i] = stIntTuple_get(chosenEdge, 3);
+            continue;
+        }
+        if(edgesIndex == NULL) {
+            edgesIndex = edgeIndex_construct(edges, edgeNumber);
+        }
+        packedEdge *edge = stIntTuple_length(chosenEdge) >= 2 ?
+                edgeIndex_getEdge(edgesIndex, stIntTuple_get(chosenEdge, 0), stIntTuple_get(chosenEdge, 1)) : NULL;
+        if(edge == NULL) {
+            st_errAbort("The matching algorithm chose an edge that is not one of the edges it was given");
+        }
+        indices[i] = edge->index;
+    }
+    if(edgesIndex != NULL) {
+        edgeIndex_destruct(edgesIndex);
+    }
+    *chosenNumber = stList_length(chosenEdges);
+    return indices;
+}
+
+static int64_t *matchEdges(packedEdge *edges, int64_t edgeNumber, int64_t nodeNumber,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t *chosenNumber) {
     /*
-     * Translate the edges.
+     * Matches the rebased edges with the matching algorithm, returning the indices carried by the chosen edges. Only the
+     * matching algorithm is given a list of tuples.
      */
-    stSortedSet *originalEdgesSet = stList_getSortedSet(originalEdges, (int (*)(const void *, const void *))stIntTuple_cmpFn);
-    stList *edges = stList_construct();
-    for(int64_t i=0; i<stList_length(rebasedEdges); i++) {
-        stIntTuple *rebasedEdge = stList_get(rebasedEdges, i);
-        stIntTuple *node1 = getItemForNode(stIntTuple_get(rebasedEdge, 0), rebasedNodesToNodes);
-        stIntTuple *node2 = getItemForNode(stIntTuple_get(rebasedEdge, 1), rebasedNodesToNodes);
-        assert(node1 != NULL);
-        assert(node2 != NULL);
-        stIntTuple *edge = getWeightedEdgeFromSet(stIntTuple_get(node1, 0), stIntTuple_get(node2, 0), originalEdgesSet);
-        assert(edge != NULL);
-        stList_append(edges, edge);
-    }
-    stSortedSet_destruct(originalEdgesSet);
-    return edges;
+    stList *tupleEdges = getMatchingAlgorithmEdges(edges, edgeNumber);
+    stList *chosenEdges = matchingAlgorithm(tupleEdges, nodeNumber);
+    int64_t *indices = translateEdges2(chosenEdges, edges, edgeNumber, chosenNumber);
+    stList_destruct(chosenEdges);
+    stList_destruct(tupleEdges);
+    return indices;
+}
+
+int64_t *getSparseMatchingOfPackedEdges(stSortedSet *nodes, packedEdge *edges, int64_t edgeNumber,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t *chosenNumber) {
+    if (stSortedSet_size(nodes) == 0) { //Some of the following functions assume there are at least 2 nodes.
+        *chosenNumber = 0;
+        return st_malloc(sizeof(int64_t));
+    }
+    rebasedNodes *rN = rebaseNodes(nodes);
+    packedEdge *rebasedEdges = translateEdges(edges, edgeNumber, rN);
+    int64_t *chosenEdges = matchEdges(rebasedEdges, edgeNumber, stSortedSet_size(nodes), matchingAlgorithm, chosenNumber);
+    free(rebasedEdges);
+    rebasedNodes_destruct(rN);
+    return chosenEdges;
+}
+
+static stList *getChosenEdges(stList *edges, int64_t *chosenEdgeIndices, int64_t chosenNumber) {
+    stList *chosenEdges = stList_construct2(chosenNumber);
+    for(int64_t i=0; i<chosenNumber; i++) {
+        stList_set(chosenEdges, i, stList_get(edges, chosenEdgeIndices[i]));
+    }
+    return chosenEdges;
 }
 
 stList *getSparseMatching(stSortedSet *nodes,
@@ -63,33 +147,261 @@ stList *getSparseMatching(stSortedSet *nodes,
         stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber)) {
     checkEdges(adjacencyEdges, nodes, 0, 0);
 
-    if (stSortedSet_size(nodes) == 0) { //Some of the following functions assume there are at least 2 nodes.
+    /*
+     * Calculate the optimal matching of the packed edges.
+     */
+    packedEdge *edges = getPackedEdges(adjacencyEdges);
+    int64_t chosenNumber;
+    int64_t *chosenEdgeIndices = getSparseMatchingOfPackedEdges(nodes, edges, stList_length(adjacencyEdges),
+            matchingAlgorithm, &chosenNumber);
+    stList *chosenEdges = getChosenEdges(adjacencyEdges, chosenEdgeIndices, chosenNumber);
+
+    /*
+     * Clean up
+     */
+    free(chosenEdgeIndices);
+    free(edges);
+
+    st_logDebug(
+            "Chosen a sparse matching with %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
+            stList_length(chosenEdges), matchingCardinality(chosenEdges),
+            matchingWeight(chosenEdges));
+
+    return chosenEdges;
+}
+
+/*
+ * Matching each connected component separately.
+ */
+
+typedef struct _matchingComponent {
+    int64_t nodeNumber;
+    packedEdge *edges; //The edges of the component, numbered within the component, carrying the index of the original edge.
+    int64_t edgeNumber;
+    bool ownsEdges;
+    int64_t *matching; //The indices of the chosen edges.
+    int64_t matchingLength;
+} matchingComponent;
+
+static stList *getMatchingComponents(packedEdge *rebasedEdges, int64_t edgeNumber, int64_t nodeNumber) {
+    /*
+     * Splits the rebased edges into the connected components of the graph they form, numbering the nodes of each
+     * component from 0. Nodes without edges are not in any component. Components are ordered by their smallest node.
+     */
+    int64_t *parents = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        parents[i] = i;
+    }
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        int64_t i1 = findRoot(parents, rebasedEdges[i].node1);
+        int64_t i2 = findRoot(parents, rebasedEdges[i].node2);
+        if (i1 != i2) {
+            parents[i1 > i2 ? i1 : i2] = i1 > i2 ? i2 : i1; //The root is the smallest node of the component.
+        }
+    }
+    int64_t *componentSizes = st_calloc(nodeNumber + 1, sizeof(int64_t));
+    int64_t *localNodes = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        parents[i] = findRoot(parents, i); //So that each node points at the root of its component.
+        localNodes[i] = componentSizes[parents[i]]++;
+    }
+    int64_t *componentEdgeNumbers = st_calloc(nodeNumber + 1, sizeof(int64_t));
+    for (int64_t i = 0; i < edgeNumber; i++) {
+        componentEdgeNumbers[parents[rebasedEdges[i].node1]]++;
+    }
+    //Components with more than one node have edges.
+    stList *components = stList_construct();
+    matchingComponent **rootsToComponents = st_calloc(nodeNumber + 1, sizeof(matchingComponent *));
+    for (int64_t i = 0; i < nodeNumber; i++) {
+        int64_t root = parents[i];
+        if (componentSizes[root] > 1 && rootsToComponents[root] == NULL) {
+            matchingComponent *component = st_malloc(sizeof(matchingComponent));
+            component->nodeNumber = componentSizes[root];
+            component->edgeNumber = 0;
+            component->matching = NULL;
+            component->matchingLength = 0;
+            rootsToComponents[root] = component;
+            stList_append(components, component);
+        }
+    }
+    if (stList_length(components) == 1 && ((matchingComponent *) stList_get(components, 0))->nodeNumber == nodeNumber) {
+        //A single component of all the nodes is numbered as the rebased graph, so it shares the rebased edges.
+        matchingComponent *component = stList_get(components, 0);
+        component->edges = rebasedEdges;
+        component->edgeNumber = edgeNumber;
+        component->ownsEdges = 0;
+    } else {
+        for (int64_t i = 0; i < stList_length(components); i++) {
+            matchingComponent *component = stList_get(components, i);
+            component->edges = NULL;
+            component->ownsEdges = 1;
+        }
+        for (int64_t i = 0; i < edgeNumber; i++) {
+            packedEdge *edge = &rebasedEdges[i];
+            int64_t root = parents[edge->node1];
+            matchingComponent *component = rootsToComponents[root];
+            assert(component != NULL && component == rootsToComponents[parents[edge->node2]]);
+            if (component->edges == NULL) {
+                component->edges = st_malloc(sizeof(packedEdge) * (componentEdgeNumbers[root] + 1));
+            }
+            //Numbering within the component keeps the order of the nodes, so the smaller node stays first.
+            packedEdge *localEdge = &component->edges[component->edgeNumber++];
+            localEdge->node1 = localNodes[edge->node1];
+            localEdge->node2 = localNodes[edge->node2];
+            localEdge->weight = edge->weight;
+            localEdge->index = edge->index;
+        }
+    }
+    free(rootsToComponents);
+    free(componentEdgeNumbers);
+    free(localNodes);
+    free(componentSizes);
+    free(parents);
+    return components;
+}
+
+static void matchingComponent_destruct(matchingComponent *component) {
+    free(component->matching);
+    if (component->ownsEdges) {
+        free(component->edges);
+    }
+    free(component);
+}
+
+//Components with at most this many nodes have no two disjoint edges, so are matched without calling the matching algorithm.
+static const int64_t maximumTrivialComponentSize = 3;
+
+static void matchTrivialComponent(matchingComponent *component) {
+    /*
+     * Every pair of edges shares a node, so the matching is the heaviest edge, the first in the array if tied, or is empty
+     * if no edge has positive weight, as a maximum weight matching gains nothing from such an edge.
+     */
+    packedEdge *heaviestEdge = NULL;
+    for (int64_t i = 0; i < component->edgeNumber; i++) {
+        if (heaviestEdge == NULL || component->edges[i].weight > heaviestEdge->weight) {
+            heaviestEdge = &component->edges[i];
+        }
+    }
+    assert(heaviestEdge != NULL);
+    component->matching = st_malloc(sizeof(int64_t));
+    component->matchingLength = 0;
+    if (heaviestEdge->weight > 0) {
+        component->matching[component->matchingLength++] = heaviestEdge->index;
+    }
+}
+
+typedef struct _componentMatchingState {
+    stList *components; //The components to pass to the matching algorithm, largest first.
+    int64_t nextComponent;
+    pthread_mutex_t mutex;
+    stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber);
+} componentMatchingState;
+
+static void *matchComponents(void *arg) {
+    /*
+     * Takes components from the state until none are left.
+     */
+    componentMatchingState *state = arg;
+    while (1) {
+        pthread_mutex_lock(&state->mutex);
+        int64_t i = state->nextComponent++;
+        pthread_mutex_unlock(&state->mutex);
+        if (i >= stList_length(state->components)) {
+            return NULL;
+        }
+        matchingComponent *component = stList_get(state->components, i);
+        component->matching = matchEdges(component->edges, component->edgeNumber, component->nodeNumber,
+                state->matchingAlgorithm, &component->matchingLength);
+    }
+}
+
+static int compareComponentsBySize(const void *a, const void *b) {
+    int64_t i = ((matchingComponent *) a)->nodeNumber, j = ((matchingComponent *) b)->nodeNumber;
+    return i > j ? -1 : (i < j ? 1 : 0);
+}
+
+static void matchComponentsInParallel(stList *components,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber) {
+    /*
+     * Matches the trivial components directly, then the rest with the matching algorithm using up to threadNumber threads,
+     * starting with the largest so that the small components are matched alongside it.
+     */
+    componentMatchingState state;
+    state.components = stList_construct();
+    state.nextComponent = 0;
+    state.matchingAlgorithm = matchingAlgorithm;
+    pthread_mutex_init(&state.mutex, NULL);
+    for (int64_t i = 0; i < stList_length(components); i++) {
+        matchingComponent *component = stList_get(components, i);
+        if (component->nodeNumber <= maximumTrivialComponentSize) {
+            matchTrivialComponent(component);
+        } else {
+            stList_append(state.components, component);
+        }
+    }
+    stList_sort(state.components, compareComponentsBySize);
+    int64_t jobNumber = threadNumber < stList_length(state.components) ? threadNumber : stList_length(state.components);
+    pthread_t *threads = st_malloc(sizeof(pthread_t) * (jobNumber + 1));
+    //The calling thread also matches components.
+    for (int64_t i = 1; i < jobNumber; i++) {
+        if (pthread_create(&threads[i], NULL, matchComponents, &state) != 0) {
+            st_errAbort("Failed to create a thread to compute a matching");
+        }
+    }
+    matchComponents(&state);
+    for (int64_t i = 1; i < jobNumber; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+    pthread_mutex_destroy(&state.mutex);
+    stList_destruct(state.components);
+}
+
+stList *getSparseMatchingByComponents(stSortedSet *nodes,
+        stList *adjacencyEdges,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber) {
+    checkEdges(adjacencyEdges, nodes, 0, 0);
+    assert(threadNumber >= 1);
+
+    if (stSortedSet_size(nodes) == 0) {
         return stList_construct();
     }
 
     /*
-     * First calculate the optimal matching.
+     * Split the rebased graph of the packed edges into its components and match them.
      */
-    stHash *nodesToRebasedNodes = rebaseNodes(nodes);
-    stHash *rebasedNodesToNodes = stHash_invert(nodesToRebasedNodes, (uint64_t(*)(const void *)) stIntTuple_hashKey,
-            (int(*)(const void *, const void *)) stIntTuple_equalsFn, NULL, NULL);
-    stList *rebasedEdges = translateEdges(adjacencyEdges, nodesToRebasedNodes);
-    stList *chosenRebasedEdges = matchingAlgorithm(rebasedEdges, stSortedSet_size(nodes));
-    stList *chosenEdges = translateEdges2(chosenRebasedEdges, rebasedNodesToNodes, adjacencyEdges);
+    packedEdge *edges = getPackedEdges(adjacencyEdges);
+    rebasedNodes *rN = rebaseNodes(nodes);
+    packedEdge *rebasedEdges = translateEdges(edges, stList_length(adjacencyEdges), rN);
+    stList *components = getMatchingComponents(rebasedEdges, stList_length(adjacencyEdges), stSortedSet_size(nodes));
+    matchComponentsInParallel(components, matchingAlgorithm, threadNumber);
+
+    /*
+     * Concatenate the matchings, in order of component.
+     */
+    stList *chosenEdges = stList_construct();
+    for (int64_t i = 0; i < stList_length(components); i++) {
+        matchingComponent *component = stList_get(components, i);
+        for (int64_t j = 0; j < component->matchingLength; j++) {
+            stList_append(chosenEdges, stList_get(adjacencyEdges, component->matching[j]));
+        }
+    }
 
     /*
      * Clean up
      */
-    stList_destruct(chosenRebasedEdges);
-    stList_destruct(rebasedEdges);
-    stHash_destruct(nodesToRebasedNodes);
-    stHash_destruct(rebasedNodesToNodes);
+    for (int64_t i = 0; i < stList_length(components); i++) {
+        matchingComponent_destruct(stList_get(components, i));
+    }
+    stList_destruct(components);
+    free(rebasedEdges);
+    rebasedNodes_destruct(rN);
+    free(edges);
 
     st_logDebug(
-            "Chosen a sparse matching with %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
+            "Chosen a sparse matching by components with %" PRIi64 " edges, %" PRIi64 " cardinality and %" PRIi64 " weight\n",
             stList_length(chosenEdges), matchingCardinality(chosenEdges),
             matchingWeight(chosenEdges));
 
     return chosenEdges;
 }
-
@@ -13,12 +13,36 @@
 
 #include "sonLib.h"
 
+/*
+ * How thoroughly the inputs to the algorithms are checked. Full checks build a set of the edges, fast checks make the
+ * same checks by sorting arrays of the edges and their nodes, and off skips the checks. Failed checks abort, whether or not asserts are
+ * compiled in. The default is full, or off if NDEBUG is defined.
+ */
+typedef enum _edgeValidationLevel {
+    EDGE_VALIDATION_OFF, EDGE_VALIDATION_FAST, EDGE_VALIDATION_FULL
+} edgeValidationLevel;
+
+void setEdgeValidationLevel(edgeValidationLevel level);
+
+edgeValidationLevel getEdgeValidationLevel(void);
+
+/*
+ * Aborts with the message if the condition, a check of the inputs, is false.
+ */
+void checkEdgesCondition(bool condition, const char *message);
+
 /*
  * Check the edges all refer to nodes between 0 and node number. If length three, check final argument
  * (which is a weight), is greater than or equal to zero. Check that if coversAllNodes is non-zero, all nodes are
- * covered. Checks edges from clique if isClique is non-zero.
+ * covered. Checks edges from clique if isClique is non-zero. Does nothing if the validation level is off.
  */
 void checkEdges(stList *edges, stSortedSet * nodes, bool coversAllNodes,
         bool isClique);
 
+/*
+ * Makes the checks of checkEdges at the given level, returning a description of the first problem found, or NULL if there is none.
+ */
+const char *getEdgesError(stList *edges, stSortedSet * nodes, bool coversAllNodes,
+        bool isClique, edgeValidationLevel level);
+
 #endif
@@ -41,18 +41,77 @@
  * The matching algorithm is one used to construct an initial matching.
  *
  * The return is the matching, as a list of node pairs, of the same form as the stub end adjacency edges.
- * The list of adjacency edges may be added to with new 'pseudo' adjacency edges, if necessary.
+ * The list of adjacency edges is not changed.
  */
 stList *getMatchingWithCyclicConstraints(stSortedSet *nodes,
         stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
         bool makeStubCyclesDisjoint,
         stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber));
 
+/*
+ * As getMatchingWithCyclicConstraints, but cycles containing multiple stub edges are split using up to threadNumber threads.
+ * The result does not depend on the number of threads.
+ */
+stList *getMatchingWithCyclicConstraints2(stSortedSet *nodes,
+        stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber);
+
+/*
+ * As getMatchingWithCyclicConstraints2, but the adjacency edges need not be a clique: a pair of nodes without an edge is
+ * treated as joined by a zero weight edge, so only the non-zero weight edges need be given, and neither the perfect
+ * matching nor the merges and splits that impose the constraints index more than the given edges. The adjacency edges are
+ * not changed. The zero weight edges the matching uses that are not adjacency edges are created and returned in
+ * zeroWeightEdges, a list that destructs them, which must outlive the matching.
+ */
+stList *getMatchingWithCyclicConstraints3(stSortedSet *nodes,
+        stList *adjacencyEdges, stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber,
+        stList **zeroWeightEdges);
+
+/*
+ * One of a batch of independent problems, with the arguments of getMatchingWithCyclicConstraints.
+ */
+typedef struct _cyclicConstraintsProblem {
+    stSortedSet *nodes;
+    stList *adjacencyEdges;
+    stList *stubEdges;
+    stList *chainEdges;
+    bool makeStubCyclesDisjoint;
+} cyclicConstraintsProblem;
+
+/*
+ * Solves each of the problems, a list of cyclicConstraintsProblem, as getMatchingWithCyclicConstraints, using up to threadNumber threads.
+ * Returns a list of the matchings, in the order of the problems, which destructs the matchings. The matching algorithm must be safe
+ * to call concurrently.
+ */
+stList *getMatchingsWithCyclicConstraints(stList *problems,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber);
+
+/*
+ * As getMatchingsWithCyclicConstraints, but each problem is solved as getMatchingWithCyclicConstraints3, so only the
+ * non-zero weight adjacency edges need be given. zeroWeightEdges is set to a list, in the order of the problems, of
+ * the lists of created zero weight edges, which destructs them and must outlive the matchings.
+ */
+stList *getMatchingsWithCyclicConstraints2(stList *problems,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber,
+        stList **zeroWeightEdges);
+
 stList *makeMatchingObeyCyclicConstraints(stSortedSet *nodes,
         stList *chosenEdges,
         stSortedSet *allAdjacencyEdges, stList *nonZeroWeightAdjacencyEdges,
         stList *stubEdges, stList *chainEdges,
         bool makeStubCyclesDisjoint);
 
+/*
+ * As makeMatchingObeyCyclicConstraints, splitting cycles containing multiple stub edges using up to threadNumber threads.
+ */
+stList *makeMatchingObeyCyclicConstraints2(stSortedSet *nodes,
+        stList *chosenEdges,
+        stSortedSet *allAdjacencyEdges, stList *nonZeroWeightAdjacencyEdges,
+        stList *stubEdges, stList *chainEdges,
+        bool makeStubCyclesDisjoint, int64_t threadNumber);
+
 #endif /* CYCLE_CONSTRAINED_MATCHING_ALGORITHMS_H_ */
 
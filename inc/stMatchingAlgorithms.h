@@ -22,10 +22,36 @@ stIntTuple *constructEdge(int64_t node1, int64_t node2);
 
 stIntTuple *constructWeightedEdge(int64_t node1, int64_t node2, int64_t weight);
 
+/*
+ * Options for the blossom5 solver, see PerfectMatching::Options in externalTools/blossom/PerfectMatching.h. A dualGreedyUpdateOption
+ * of 2 or a dualLPThreshold greater than zero need the solver to be built with double costs, by making with blossomDoubleCosts=1.
+ */
+typedef struct _blossom5Options {
+    bool fractionalJumpstart; //Start from a fractional matching, otherwise from a greedy one.
+    int64_t dualGreedyUpdateOption; //0: update duals by connected components, 1: by strongly connected components, 2: one epsilon for all trees.
+    double dualLPThreshold; //Update duals greedily while the number of trees is at least this fraction of the nodes, otherwise solve an LP.
+    bool updateDualsBefore; //Update duals before growing trees.
+    bool updateDualsAfter; //Update duals after growing trees.
+    double singleTreeThreshold; //Grow a single tree as long as possible while the number of trees is at least this fraction of the nodes.
+} blossom5Options;
+
+/*
+ * Gets the default options of the solver.
+ */
+blossom5Options blossom5Options_getDefault(void);
+
+/*
+ * Gets the largest edge weight blossom5 accepts, which depends on whether the solver is built with int or double costs.
+ * The blossom5 based algorithms match graphs with larger weights, or maximum cardinality matchings whose ties cannot be
+ * broken by weight within this range, with the Edmonds algorithm in 64 bit integers, which takes O(n^3) time.
+ * Matching sessions only accept weights up to this.
+ */
+int64_t chooseMatching_getMaximumBlossom5Weight(void);
+
 /*
  * Uses the blossom5 maximum weight perfect matching algorithm to choose a matching
- * between the edges. The returned matching is not necessarily perfect, rather extra edges are
- * allowed to make the graph all connected. Edges are stIntTuple's of
+ * between the edges. The returned matching is not necessarily perfect, rather extra nodes and zero weight
+ * edges are added internally so that a perfect matching exists. Edges are stIntTuple's of
  * length 3 of the form (node1, node2, weight), where node1 and node2 are indices
  * greater than or equal to zero and less than the total node number and weight
  * is a positive integer weight.
@@ -37,11 +63,21 @@ stList *chooseMatching_blossom5(stList *edges, int64_t nodeNumber);
  */
 stList *chooseMatching_maximumCardinalityMatching(stList *edges, int64_t nodeNumber);
 
+/*
+ * As chooseMatching_maximumCardinalityMatching, with the given solver options, or the defaults if options is NULL.
+ */
+stList *chooseMatching_maximumCardinalityMatching2(stList *edges, int64_t nodeNumber, const blossom5Options *options);
+
 /*
  * Finds maximum weight matching. Same form as the blossum algorithm.
  */
 stList *chooseMatching_maximumWeightMatching(stList *edges, int64_t nodeNumber);
 
+/*
+ * As chooseMatching_maximumWeightMatching, with the given solver options, or the defaults if options is NULL.
+ */
+stList *chooseMatching_maximumWeightMatching2(stList *edges, int64_t nodeNumber, const blossom5Options *options);
+
 /*
  * Uses a greedy algorithm to choose the matching, starting with the highest weight pair
  * edges are selected in descending order of weight until no further edges can be added to the matching.
@@ -50,6 +86,87 @@ stList *chooseMatching_maximumWeightMatching(stList *edges, int64_t nodeNumber);
  */
 stList *chooseMatching_greedy(stList *edges, int64_t nodeNumber);
 
+/*
+ * A maximum weight matching of a graph that changes by small steps. The blossom5 solution is kept between changes, so
+ * that the matching is recomputed starting from the previous one rather than from scratch. Weights must be at most
+ * chooseMatching_getMaximumBlossom5Weight() in magnitude.
+ */
+typedef struct _matchingSession matchingSession;
+
+/*
+ * Creates a session for the edges, of the same form as for the blossom algorithm, and computes their maximum weight matching.
+ * The session copies the edges. The edges are indexed in the session by their position in the list.
+ */
+matchingSession *matchingSession_construct(stList *edges, int64_t nodeNumber);
+
+/*
+ * As matchingSession_construct, with the given solver options, or the defaults if options is NULL.
+ */
+matchingSession *matchingSession_construct2(stList *edges, int64_t nodeNumber, const blossom5Options *options);
+
+/*
+ * As matchingSession_construct2, leaving room in the solver for expectedEdgeAdditions calls to matchingSession_addEdge.
+ * Adding more edges than this is allowed, but each time the room runs out the problem is remade with twice the room and
+ * solved again from scratch. matchingSession_construct2 leaves room for as many additions as there are edges.
+ */
+matchingSession *matchingSession_construct3(stList *edges, int64_t nodeNumber, const blossom5Options *options,
+        int64_t expectedEdgeAdditions);
+
+void matchingSession_destruct(matchingSession *mS);
+
+/*
+ * Adds an edge (node1, node2, weight), returning its index, which follows those of the existing edges.
+ * There must not already be an edge between the two nodes.
+ */
+int64_t matchingSession_addEdge(matchingSession *mS, int64_t node1, int64_t node2, int64_t weight);
+
+/*
+ * Sets the weight of the edge with the given index.
+ */
+void matchingSession_setWeight(matchingSession *mS, int64_t edgeIndex, int64_t weight);
+
+/*
+ * Gets a maximum weight matching of the edges with their current weights, updating the previous matching if the edges
+ * have changed. Returns a list of copies of the matched edges, which the list destructs.
+ */
+stList *matchingSession_getMatching(matchingSession *mS);
+
+/*
+ * Fast approximate matching algorithms. Same form as the blossom algorithm.
+ */
+
+/*
+ * The path growing algorithm of Drake and Hougardy, made maximal. Gives at least half the weight of a maximum weight matching.
+ * Takes time linear in the number of nodes and edges.
+ */
+stList *chooseMatching_pathGrowing(stList *edges, int64_t nodeNumber);
+
+/*
+ * Matches locally dominant edges, those heavier than any adjacent edge, until no edges remain between unmatched nodes.
+ * Gives at least half the weight of a maximum weight matching. Uses a thread per processor for large graphs, the result
+ * does not depend on the number of threads. Each node rescans its edges when the node it points at is matched, so the time
+ * is linear in the number of edges times the largest degree in the worst case, though close to linear in practice.
+ */
+stList *chooseMatching_locallyDominant(stList *edges, int64_t nodeNumber);
+
+/*
+ * As chooseMatching_locallyDominant, using at most the given number of threads.
+ */
+stList *chooseMatching_locallyDominant2(stList *edges, int64_t nodeNumber, int64_t threadNumber);
+
+/*
+ * Improves a matching, a subset of the given edges, by replacing a matched edge (u, v) with edges (a, u)
+ * and/or (v, b), and the edges a and b were matched by, when this increases the weight. Makes at most three passes over
+ * the matched edges, each linear in the number of nodes and edges, so some improving replacements may remain.
+ * Returns a new matching.
+ */
+stList *improveMatching_shortAugmentations(stList *edges, int64_t nodeNumber, stList *matching);
+
+/*
+ * The path growing algorithm followed by improvement with short augmentations, in linear time.
+ */
+stList *chooseMatching_pathGrowingWithAugmentations(stList *edges, int64_t nodeNumber);
+
 /*
  * Returns number of edges with weight > 0.
  */
@@ -60,6 +177,10 @@ int64_t matchingCardinality(stList *matching);
  */
 int64_t matchingWeight(stList *matching);
 
+/*
+ * Gets the connected components of the edges, as a list of lists of edges, in the order of the first edge of each component
+ * in the list. The edges of each component are in the order of the list.
+ */
 stList *getComponents(stList *edges);
 
 #endif /* EXTERNALALGORITHMS_H_ */
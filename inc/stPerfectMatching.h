@@ -20,4 +20,14 @@ stList *getPerfectMatching(stSortedSet *nodes,
         stList *adjacencyEdges,
         stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber));
 
+/*
+ * As getPerfectMatching, but the adjacency edges need not be a clique: a pair of nodes without an edge is treated
+ * as joined by a zero weight edge, so only the non-zero weight edges need be given. The adjacency edges are not changed.
+ * The zero weight edges the matching uses that are not adjacency edges are created and returned in zeroWeightEdges,
+ * a list that destructs them, which must outlive the matching.
+ */
+stList *getPerfectMatching2(stSortedSet *nodes,
+        stList *adjacencyEdges,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), stList **zeroWeightEdges);
+
 #endif
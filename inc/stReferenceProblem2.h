@@ -18,6 +18,8 @@ typedef struct _refAdjListIt refAdjListIt;
 
 typedef struct _reference refOrdering;
 
+typedef struct _zScoreCalculator zScoreCalculator;
+
 struct _refEdge {
     int64_t to;
     double weight;
@@ -76,6 +78,10 @@ void reference_makeNewInterval(refOrdering *ref, int64_t leftNode, int64_t right
 
 void reference_insertNode(refOrdering *ref, int64_t pNode, int64_t node);
 
+//Replaces the nodes between the first and last node of the interval starting with firstNode with orderedNodes, a list of stIntTuple nodes,
+//relinking and relabelling the interval in one pass. The nodes in orderedNodes must not be in the reference, other than within the interval.
+void reference_replaceIntervalContents(refOrdering *ref, int64_t firstNode, stList *orderedNodes);
+
 bool reference_inGraph(refOrdering *ref, int64_t n);
 
 int64_t reference_getFirstOfInterval(refOrdering *ref, int64_t interval);
@@ -107,6 +113,11 @@ void reference_log(refOrdering *ref);
 //Splits an interval into two, making the existing interval end with stub1, and the new interval (which will be last interval) start with stub2.
 void reference_splitInterval(refOrdering *ref, int64_t pNode, int64_t stub1, int64_t stub2);
 
+//Splits an interval after each node in pNodes, a list of stIntTuple nodes in the order they occur within one interval, in one pass.
+//Each split is as made by reference_splitInterval, using new stubs numbered above any node previously added to the reference.
+//Returns the new stubs, as for splitReferenceAtIndicatedLocations.
+stList *reference_splitIntervalAtNodes(refOrdering *ref, stList *pNodes);
+
 //Gets the maximum value of a node in the reference. Makes it easy to generate a unique new node.
 int64_t reference_getMaximumNode(refOrdering *ref);
 
@@ -159,4 +170,18 @@ double constantTemperatureFn(double d);
 
 long double calculateZScore(int64_t n, int64_t m, int64_t k, long double theta);
 
+/*
+ * Evaluates calculateZScore for a fixed theta using tables of the powers of (1 - theta), avoiding calls to pow.
+ * Lengths greater than maxLength, or negative, fall back to calculateZScore.
+ */
+zScoreCalculator *zScoreCalculator_construct(long double theta, int64_t maxLength);
+
+void zScoreCalculator_destruct(zScoreCalculator *zS);
+
+long double zScoreCalculator_get(zScoreCalculator *zS, int64_t n, int64_t m, int64_t k);
+
+//Sets zScores[i] to the Z-score of (n[i], m[i], k[i]) for 0 <= i < length.
+void zScoreCalculator_getBatch(zScoreCalculator *zS, const int64_t *n, const int64_t *m, const int64_t *k, long double *zScores,
+        int64_t length);
+
 #endif /* REFERENCEPROBLEM2_H_ */
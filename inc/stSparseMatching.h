@@ -15,10 +15,21 @@
 
 /*
  * Gets a matching for the set of nodes, which are represented as integers in the set nodes, for the
- * given matching algorithm.
+ * given matching algorithm. The nodes are renumbered from 0 for the matching algorithm, and each edge given to it
+ * has a fourth value, an index used to find the original edge. The algorithm should return edges from its input; any other
+ * edges it returns are matched to its input edges by their nodes, and it is an error if there is no such input edge.
  */
 stList *getSparseMatching(stSortedSet *nodes,
         stList *adjacencyEdges,
         stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber));
 
+/*
+ * As getSparseMatching, but matches each connected component of the graph separately, using up to threadNumber threads,
+ * so the matching algorithm must be safe to call concurrently. Components of at most three nodes are matched by taking their
+ * heaviest edge, if its weight is positive. The matchings of the components are concatenated in order of the smallest node of each component.
+ */
+stList *getSparseMatchingByComponents(stSortedSet *nodes,
+        stList *adjacencyEdges,
+        stList *(*matchingAlgorithm)(stList *edges, int64_t nodeNumber), int64_t threadNumber);
+
 #endif
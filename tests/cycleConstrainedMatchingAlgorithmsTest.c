@@ -8,6 +8,8 @@
 #include "sonLib.h"
 #include "stMatchingAlgorithms.h"
 #include "stCycleConstrainedMatchingAlgorithms.h"
+#include "stPerfectMatching.h"
+#include "stCheckEdges.h"
 #include "shared.h"
 
 /*
@@ -263,6 +265,31 @@ static void testGetComponents(CuTest *testCase) {
     }
 }
 
+static void testGetComponentsLongPath(CuTest *testCase) {
+    /*
+     * A path long enough to overflow the stack if the components were found by recursion, given in a random order
+     * along with a second, disjoint path.
+     */
+    int64_t pathLength = 1000000;
+    stList *edges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < pathLength; i++) {
+        addEdgeToList(i, i + 1, edges);
+        addEdgeToList(pathLength + 1 + 2 * i, pathLength + 3 + 2 * i, edges);
+    }
+    for (int64_t i = stList_length(edges) - 1; i > 0; i--) {
+        int64_t j = st_randomInt(0, i + 1);
+        void *edge = stList_get(edges, i);
+        stList_set(edges, i, stList_get(edges, j));
+        stList_set(edges, j, edge);
+    }
+    stList *components = getComponents(edges);
+    CuAssertIntEquals(testCase, 2, stList_length(components));
+    CuAssertIntEquals(testCase, pathLength, stList_length(stList_get(components, 0)));
+    CuAssertIntEquals(testCase, pathLength, stList_length(stList_get(components, 1)));
+    stList_destruct(components);
+    stList_destruct(edges);
+}
+
 static void testMergeSimpleCycles(CuTest *testCase) {
     /*
      * Gets a random set of cycles and checks that the output
@@ -312,8 +339,47 @@ static void testMergeSimpleCycles(CuTest *testCase) {
     }
 }
 
-static void checkMatching(CuTest *testCase, stList *chosenEdges,
-        bool makeStubsDisjoint) {
+static void testMergeManySimpleCycles(CuTest *testCase) {
+    /*
+     * Merges many two node cycles, each a chain edge and the adjacency edge between its nodes,
+     * and checks the output is a perfect matching of the nodes forming one cycle with the chain edges.
+     */
+    int64_t cycleNumber = 300;
+    stList *cliqueEdges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    stList *pairChainEdges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    stList *cycles = stList_construct3(0, (void(*)(void *)) stList_destruct);
+    for (int64_t i = 0; i < 2 * cycleNumber; i++) {
+        for (int64_t j = i + 1; j < 2 * cycleNumber; j++) {
+            addWeightedEdgeToList(i, j, st_random() > 0.8 ? st_randomInt(0, 100) : 0, cliqueEdges);
+            if (j == i + 1 && i % 2 == 0) {
+                addEdgeToList(i, j, pairChainEdges);
+                stList *cycle = stList_construct();
+                stList_append(cycle, stList_peek(cliqueEdges));
+                stList_append(cycles, cycle);
+            }
+        }
+    }
+    stList *nonZeroWeightAdjacencyEdges = getEdgesWithGreaterThanZeroWeight(cliqueEdges);
+    stSortedSet *allAdjacencyEdges = stList_getSortedSet(cliqueEdges, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+    stList *simpleCycle = mergeSimpleCycles(cycles, nonZeroWeightAdjacencyEdges, allAdjacencyEdges);
+    CuAssertIntEquals(testCase, cycleNumber, stList_length(simpleCycle));
+    stSortedSet *nodeSet = getNodeSetOfEdges(simpleCycle);
+    CuAssertIntEquals(testCase, 2 * cycleNumber, stSortedSet_size(nodeSet));
+    stList_appendAll(simpleCycle, pairChainEdges);
+    testComponentIsNotDisjoint(testCase, simpleCycle);
+
+    //Cleanup
+    stSortedSet_destruct(nodeSet);
+    stList_destruct(simpleCycle);
+    stList_destruct(cycles);
+    stList_destruct(nonZeroWeightAdjacencyEdges);
+    stSortedSet_destruct(allAdjacencyEdges);
+    stList_destruct(pairChainEdges);
+    stList_destruct(cliqueEdges);
+}
+
+static void checkMatching2(CuTest *testCase, stList *chosenEdges, int64_t nodeNumber,
+        stList *stubEdges, stList *chainEdges, bool makeStubsDisjoint) {
     /*
      * Check every node has one adjacency.
      */
@@ -349,6 +415,11 @@ static void checkMatching(CuTest *testCase, stList *chosenEdges,
     stList_destruct(components);
 }
 
+static void checkMatching(CuTest *testCase, stList *chosenEdges,
+        bool makeStubsDisjoint) {
+    checkMatching2(testCase, chosenEdges, nodeNumber, stubEdges, chainEdges, makeStubsDisjoint);
+}
+
 static void testEmptyCase(CuTest *testCase) {
     /*
      * First test the empty case..
@@ -442,12 +513,280 @@ static void testGetMatchingWithCyclicConstraints_MaximumCardinality_MakeStubsDis
             chooseMatching_maximumCardinalityMatching, 1, 50, 50);
 }
 
+static void testMakeMatchingObeyCyclicConstraintsInParallel(CuTest *testCase) {
+    /*
+     * Checks that splitting the stub cycles with several threads gives the same matching as with one.
+     */
+    for (int64_t i = 0; i < 20; i++) {
+        setup(200);
+        stList *chosenEdges = getPerfectMatching(nodes, adjacencyEdges, chooseMatching_blossom5);
+        stSortedSet *allAdjacencyEdges = stList_getSortedSet(adjacencyEdges, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+        stList *nonZeroWeightAdjacencyEdges = getEdgesWithGreaterThanZeroWeight(adjacencyEdges);
+        stList *matching = makeMatchingObeyCyclicConstraints(nodes, chosenEdges, allAdjacencyEdges,
+                nonZeroWeightAdjacencyEdges, stubEdges, chainEdges, 1);
+        stList *parallelMatching = makeMatchingObeyCyclicConstraints2(nodes, chosenEdges, allAdjacencyEdges,
+                nonZeroWeightAdjacencyEdges, stubEdges, chainEdges, 1, 4);
+        checkMatching(testCase, parallelMatching, 1);
+        CuAssertIntEquals(testCase, stList_length(matching), stList_length(parallelMatching));
+        for (int64_t j = 0; j < stList_length(matching); j++) {
+            CuAssertTrue(testCase, stList_get(matching, j) == stList_get(parallelMatching, j));
+        }
+
+        //Cleanup
+        stList_destruct(parallelMatching);
+        stList_destruct(matching);
+        stList_destruct(nonZeroWeightAdjacencyEdges);
+        stSortedSet_destruct(allAdjacencyEdges);
+        stList_destruct(chosenEdges);
+        teardown();
+    }
+}
+
+static void testGetEdgesError(CuTest *testCase) {
+    /*
+     * Checks that the fast and full checks accept valid edges, including nodes with widely spaced numbers, and reject
+     * each kind of invalid edges.
+     */
+    stSortedSet *nodes = getEmptyNodeOrEdgeSetWithCleanup();
+    for (int64_t i = 0; i < 4; i++) {
+        addNodeToSet(nodes, i * 1000000);
+    }
+    stList *edges = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+    for (int64_t i = 0; i < 4; i++) {
+        for (int64_t j = i + 1; j < 4; j++) {
+            addWeightedEdgeToList(i * 1000000, j * 1000000, i + j, edges);
+        }
+    }
+    edgeValidationLevel levels[] = { EDGE_VALIDATION_FAST, EDGE_VALIDATION_FULL };
+    for (int64_t i = 0; i < 2; i++) {
+        CuAssertTrue(testCase, getEdgesError(edges, nodes, 1, 1, levels[i]) == NULL);
+    }
+    for (int64_t k = 0; k < 6; k++) {
+        stList *invalidEdges = stList_copy(edges, NULL);
+        stIntTuple *invalidEdge = NULL;
+        bool coversAllNodes = 0, isClique = 0;
+        switch (k) {
+        case 0: //Duplicate edge, with the nodes the other way around.
+            invalidEdge = stIntTuple_construct3(1000000, 0, 5);
+            break;
+        case 1: //Self edge.
+            invalidEdge = stIntTuple_construct3(1000000, 1000000, 5);
+            break;
+        case 2: //Node out of range.
+            invalidEdge = stIntTuple_construct3(0, 4000000, 5);
+            break;
+        case 3: //Negative weight.
+            stList_pop(invalidEdges);
+            invalidEdge = stIntTuple_construct3(2000000, 3000000, -1);
+            break;
+        case 4: //Does not cover the nodes.
+            for (int64_t j = stList_length(invalidEdges) - 1; j >= 0; j--) {
+                stIntTuple *edge = stList_get(invalidEdges, j);
+                if (stIntTuple_get(edge, 0) == 3000000 || stIntTuple_get(edge, 1) == 3000000) {
+                    stList_remove(invalidEdges, j);
+                }
+            }
+            coversAllNodes = 1;
+            break;
+        default: //Not a clique.
+            stList_pop(invalidEdges);
+            isClique = 1;
+            break;
+        }
+        if (invalidEdge != NULL) {
+            stList_append(invalidEdges, invalidEdge);
+        }
+        for (int64_t i = 0; i < 2; i++) {
+            CuAssertTrue(testCase, getEdgesError(invalidEdges, nodes, coversAllNodes, isClique, levels[i]) != NULL);
+        }
+        CuAssertTrue(testCase, getEdgesError(invalidEdges, nodes, coversAllNodes, isClique, EDGE_VALIDATION_OFF) == NULL);
+        if (invalidEdge != NULL) {
+            stIntTuple_destruct(invalidEdge);
+        }
+        stList_destruct(invalidEdges);
+    }
+    stList_destruct(edges);
+    stSortedSet_destruct(nodes);
+}
+
+static void testGetPerfectMatchingWithImplicitZeroWeightEdges(CuTest *testCase) {
+    /*
+     * Checks that giving only the non-zero weight edges gives a perfect matching of the same weight as giving the clique,
+     * made of the given edges and the created zero weight edges, without changing the given edges.
+     */
+    for (int64_t i = 0; i < 20; i++) {
+        setup(200);
+        stList *chosenEdges = getPerfectMatching(nodes, adjacencyEdges, chooseMatching_blossom5);
+        stList *nonZeroWeightAdjacencyEdges = getEdgesWithGreaterThanZeroWeight(adjacencyEdges);
+        int64_t nonZeroWeightEdgeNumber = stList_length(nonZeroWeightAdjacencyEdges);
+        stList *zeroWeightEdges;
+        stList *implicitChosenEdges = getPerfectMatching2(nodes, nonZeroWeightAdjacencyEdges, chooseMatching_blossom5,
+                &zeroWeightEdges);
+        CuAssertIntEquals(testCase, nonZeroWeightEdgeNumber, stList_length(nonZeroWeightAdjacencyEdges));
+        stSortedSet *matchedNodes = getNodeSetOfEdges(implicitChosenEdges);
+        CuAssertIntEquals(testCase, nodeNumber, stSortedSet_size(matchedNodes));
+        CuAssertIntEquals(testCase, nodeNumber, 2 * stList_length(implicitChosenEdges));
+        stSortedSet_destruct(matchedNodes);
+        CuAssertIntEquals(testCase, matchingWeight(chosenEdges), matchingWeight(implicitChosenEdges));
+        for (int64_t j = 0; j < stList_length(implicitChosenEdges); j++) {
+            stIntTuple *edge = stList_get(implicitChosenEdges, j);
+            CuAssertTrue(testCase, stList_contains(nonZeroWeightAdjacencyEdges, edge) || stList_contains(zeroWeightEdges, edge));
+        }
+        for (int64_t j = 0; j < stList_length(zeroWeightEdges); j++) {
+            CuAssertIntEquals(testCase, 0, stIntTuple_get(stList_get(zeroWeightEdges, j), 2));
+            CuAssertTrue(testCase, stList_contains(implicitChosenEdges, stList_get(zeroWeightEdges, j)));
+        }
+
+        //Cleanup
+        stList_destruct(implicitChosenEdges);
+        stList_destruct(zeroWeightEdges);
+        stList_destruct(nonZeroWeightAdjacencyEdges);
+        stList_destruct(chosenEdges);
+        teardown();
+    }
+}
+
+static void testGetMatchingWithCyclicConstraintsWithImplicitZeroWeightEdges(CuTest *testCase) {
+    /*
+     * Checks that giving only the non-zero weight edges gives a matching that obeys the cyclic constraints, of the same
+     * weight as giving the clique, made of the given edges and the created zero weight edges, without changing the given edges.
+     */
+    for (int64_t i = 0; i < 20; i++) {
+        setup(200);
+        bool makeStubsDisjoint = i % 2 == 0;
+        stList *chosenEdges = getMatchingWithCyclicConstraints(nodes, adjacencyEdges, stubEdges, chainEdges,
+                makeStubsDisjoint, chooseMatching_blossom5);
+        stList *nonZeroWeightAdjacencyEdges = getEdgesWithGreaterThanZeroWeight(adjacencyEdges);
+        int64_t nonZeroWeightEdgeNumber = stList_length(nonZeroWeightAdjacencyEdges);
+        stList *zeroWeightEdges;
+        stList *implicitChosenEdges = getMatchingWithCyclicConstraints3(nodes, nonZeroWeightAdjacencyEdges, stubEdges,
+                chainEdges, makeStubsDisjoint, chooseMatching_blossom5, 1 + i % 4, &zeroWeightEdges);
+        CuAssertIntEquals(testCase, nonZeroWeightEdgeNumber, stList_length(nonZeroWeightAdjacencyEdges));
+        checkMatching(testCase, implicitChosenEdges, makeStubsDisjoint);
+        CuAssertIntEquals(testCase, matchingWeight(chosenEdges), matchingWeight(implicitChosenEdges));
+        for (int64_t j = 0; j < stList_length(implicitChosenEdges); j++) {
+            stIntTuple *edge = stList_get(implicitChosenEdges, j);
+            CuAssertTrue(testCase, stList_contains(nonZeroWeightAdjacencyEdges, edge) || stList_contains(zeroWeightEdges, edge));
+        }
+        for (int64_t j = 0; j < stList_length(zeroWeightEdges); j++) {
+            CuAssertIntEquals(testCase, 0, stIntTuple_get(stList_get(zeroWeightEdges, j), 2));
+        }
+
+        //Cleanup
+        stList_destruct(implicitChosenEdges);
+        stList_destruct(zeroWeightEdges);
+        stList_destruct(nonZeroWeightAdjacencyEdges);
+        stList_destruct(chosenEdges);
+        teardown();
+    }
+}
+
+static void testValidationLevels(CuTest *testCase) {
+    /*
+     * Checks that valid inputs pass the checks at each validation level, and that the level can be restored.
+     */
+    edgeValidationLevel level = getEdgeValidationLevel();
+    edgeValidationLevel levels[] = { EDGE_VALIDATION_OFF, EDGE_VALIDATION_FAST, EDGE_VALIDATION_FULL };
+    for (int64_t i = 0; i < 10; i++) {
+        setup(100);
+        for (int64_t j = 0; j < 3; j++) {
+            setEdgeValidationLevel(levels[j]);
+            CuAssertIntEquals(testCase, levels[j], getEdgeValidationLevel());
+            checkInputs(nodes, adjacencyEdges, stubEdges, chainEdges);
+            stList *chosenEdges = getMatchingWithCyclicConstraints(nodes,
+                    adjacencyEdges, stubEdges, chainEdges, 1, chooseMatching_blossom5);
+            checkMatching(testCase, chosenEdges, 1);
+            stList_destruct(chosenEdges);
+        }
+        setEdgeValidationLevel(level);
+        teardown();
+    }
+}
+
+static void testGetMatchingsWithCyclicConstraints(CuTest *testCase) {
+    /*
+     * Solves a batch of random problems with several threads and checks the matchings, in order, obey the cyclic constraints
+     * and are the same as those found by solving the problems one at a time. The problems solved one at a time have copies
+     * of the adjacency edges, so the edges are compared by their nodes and weights.
+     */
+    stList *problems = stList_construct3(0, free);
+    stList *matchings = stList_construct3(0, (void(*)(void *)) stList_destruct);
+    stList *inputs = stList_construct3(0, (void(*)(void *)) stList_destruct); //Keeps the edges of each problem.
+    for (int64_t i = 0; i < 50; i++) {
+        setup(i % 10 == 0 ? 100 : 20);
+        stList *adjacencyEdges2 = stList_construct3(0, (void(*)(void *)) stIntTuple_destruct);
+        for (int64_t j = 0; j < stList_length(adjacencyEdges); j++) {
+            stIntTuple *edge = stList_get(adjacencyEdges, j);
+            addWeightedEdgeToList(stIntTuple_get(edge, 0), stIntTuple_get(edge, 1), stIntTuple_get(edge, 2), adjacencyEdges2);
+        }
+        bool makeStubsDisjoint = st_random() > 0.5;
+        stList_append(matchings, getMatchingWithCyclicConstraints(nodes, adjacencyEdges2, stubEdges, chainEdges,
+                makeStubsDisjoint, chooseMatching_blossom5));
+        cyclicConstraintsProblem *problem = st_malloc(sizeof(cyclicConstraintsProblem));
+        problem->nodes = nodes;
+        problem->adjacencyEdges = adjacencyEdges;
+        problem->stubEdges = stubEdges;
+        problem->chainEdges = chainEdges;
+        problem->makeStubCyclesDisjoint = makeStubsDisjoint;
+        stList_append(problems, problem);
+        //Take ownership of the inputs from the fixture, they are freed at the end.
+        stList *input = stList_construct3(0, NULL);
+        stList_append(input, adjacencyEdges);
+        stList_append(input, adjacencyEdges2);
+        stList_append(input, stubEdges);
+        stList_append(input, chainEdges);
+        stList_append(input, nodes);
+        stList_append(inputs, input);
+        adjacencyEdges = NULL;
+        stubEdges = NULL;
+        chainEdges = NULL;
+        nodes = NULL;
+        nodeNumber = 0;
+    }
+    stList *batchMatchings = getMatchingsWithCyclicConstraints(problems, chooseMatching_blossom5, 4);
+    CuAssertIntEquals(testCase, stList_length(problems), stList_length(batchMatchings));
+    for (int64_t i = 0; i < stList_length(problems); i++) {
+        stList *matching = stList_get(matchings, i);
+        stList *batchMatching = stList_get(batchMatchings, i);
+        cyclicConstraintsProblem *problem = stList_get(problems, i);
+        checkMatching2(testCase, batchMatching, stSortedSet_size(problem->nodes), problem->stubEdges, problem->chainEdges,
+                problem->makeStubCyclesDisjoint);
+        CuAssertIntEquals(testCase, stList_length(matching), stList_length(batchMatching));
+        stList *sortedMatching = stList_copy(matching, NULL);
+        stList *sortedBatchMatching = stList_copy(batchMatching, NULL);
+        stList_sort(sortedMatching, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+        stList_sort(sortedBatchMatching, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+        for (int64_t j = 0; j < stList_length(sortedMatching); j++) {
+            stIntTuple *edge = stList_get(sortedMatching, j);
+            stIntTuple *batchEdge = stList_get(sortedBatchMatching, j);
+            CuAssertIntEquals(testCase, stIntTuple_get(edge, 0), stIntTuple_get(batchEdge, 0));
+            CuAssertIntEquals(testCase, stIntTuple_get(edge, 1), stIntTuple_get(batchEdge, 1));
+            CuAssertIntEquals(testCase, stIntTuple_get(edge, 2), stIntTuple_get(batchEdge, 2));
+        }
+        stList_destruct(sortedMatching);
+        stList_destruct(sortedBatchMatching);
+    }
+    stList_destruct(batchMatchings);
+    stList_destruct(matchings);
+    for (int64_t i = 0; i < stList_length(inputs); i++) {
+        stList *input = stList_get(inputs, i);
+        for (int64_t j = 0; j < 4; j++) {
+            stList_destruct(stList_get(input, j));
+        }
+        stSortedSet_destruct(stList_get(input, 4));
+    }
+    stList_destruct(inputs);
+    stList_destruct(problems);
+}
+
 CuSuite* cyclesConstrainedMatchingAlgorithmsTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testEmptyCase);
     SUITE_ADD_TEST(suite, testGetComponentsSimple);
     SUITE_ADD_TEST(suite, testGetComponents);
+    SUITE_ADD_TEST(suite, testGetComponentsLongPath);
     SUITE_ADD_TEST(suite, testMergeSimpleCycles);
+    SUITE_ADD_TEST(suite, testMergeManySimpleCycles);
     SUITE_ADD_TEST(suite,
             testGetMatchingWithCyclicConstraints_MaximumWeight_DontSweatJoinedStubs);
     SUITE_ADD_TEST(suite,
@@ -456,5 +795,11 @@ CuSuite* cyclesConstrainedMatchingAlgorithmsTestSuite(void) {
             testGetMatchingWithCyclicConstraints_MaximumCardinality_DontSweatJoinedStubs);
     SUITE_ADD_TEST(suite,
             testGetMatchingWithCyclicConstraints_MaximumCardinality_MakeStubsDisjoint);
+    SUITE_ADD_TEST(suite, testGetMatchingsWithCyclicConstraints);
+    SUITE_ADD_TEST(suite, testMakeMatchingObeyCyclicConstraintsInParallel);
+    SUITE_ADD_TEST(suite, testValidationLevels);
+    SUITE_ADD_TEST(suite, testGetEdgesError);
+    SUITE_ADD_TEST(suite, testGetPerfectMatchingWithImplicitZeroWeightEdges);
+    SUITE_ADD_TEST(suite, testGetMatchingWithCyclicConstraintsWithImplicitZeroWeightEdges);
     return suite;
 }
@@ -4,9 +4,11 @@
  * Released under the MIT license, see LICENSE.txt
  */
 
+#include <unistd.h>
 #include "CuTest.h"
 #include "sonLib.h"
 #include "stMatchingAlgorithms.h"
+#include "stSparseMatching.h"
 #include "shared.h"
 
 static int64_t nodeNumber = 0;
@@ -99,6 +101,36 @@ static void testGreedy(CuTest *testCase) {
         checkMatching(testCase, matching, 0);
         int64_t totalWeight = matchingWeight(matching);
         st_logInfo("The total weight of the greedy matching is %" PRIi64 "\n", totalWeight);
+        /*
+         * Check each edge not in the matching shares a node with a matched edge that is heavier, or as heavy and earlier in the list.
+         */
+        int64_t *matchedEdges = st_malloc(sizeof(int64_t) * (nodeNumber + 1));
+        for(int64_t j=0; j<nodeNumber; j++) {
+            matchedEdges[j] = -1;
+        }
+        for(int64_t j=0; j<stList_length(matching); j++) {
+            int64_t k = 0;
+            while(stList_get(edgesList, k) != stList_get(matching, j)) {
+                k++;
+            }
+            stIntTuple *edge = stList_get(edgesList, k);
+            matchedEdges[stIntTuple_get(edge, 0)] = k;
+            matchedEdges[stIntTuple_get(edge, 1)] = k;
+        }
+        for(int64_t j=0; j<stList_length(edgesList); j++) {
+            stIntTuple *edge = stList_get(edgesList, j);
+            int64_t k = matchedEdges[stIntTuple_get(edge, 0)];
+            int64_t l = matchedEdges[stIntTuple_get(edge, 1)];
+            if(k == j || l == j) {
+                continue;
+            }
+            int64_t m = k == -1 ? l : (l == -1 ? k : (stIntTuple_get(stList_get(edgesList, k), 2) > stIntTuple_get(stList_get(edgesList, l), 2) ||
+                    (stIntTuple_get(stList_get(edgesList, k), 2) == stIntTuple_get(stList_get(edgesList, l), 2) && k < l) ? k : l));
+            CuAssertTrue(testCase, m != -1);
+            int64_t weight = stIntTuple_get(edge, 2), matchedWeight = stIntTuple_get(stList_get(edgesList, m), 2);
+            CuAssertTrue(testCase, matchedWeight > weight || (matchedWeight == weight && m < j));
+        }
+        free(matchedEdges);
         stList_destruct(matching);
         teardown();
     }
@@ -161,11 +193,461 @@ static void testMaximumCardinality(CuTest *testCase) {
     }
 }
 
+static void getOptimalMatchingsExhaustively(int64_t edgeIndex, bool *covered, int64_t weight, int64_t cardinality,
+        int64_t *maxWeight, int64_t *maxCardinality, int64_t *maxWeightOfMaxCardinality) {
+    /*
+     * Enumerates every matching of the edges, recording the maximum weight, the maximum cardinality and the
+     * maximum weight of a matching of maximum cardinality.
+     */
+    if(edgeIndex == stList_length(edgesList)) {
+        if(weight > *maxWeight) {
+            *maxWeight = weight;
+        }
+        if(cardinality > *maxCardinality || (cardinality == *maxCardinality && weight > *maxWeightOfMaxCardinality)) {
+            *maxCardinality = cardinality;
+            *maxWeightOfMaxCardinality = weight;
+        }
+        return;
+    }
+    getOptimalMatchingsExhaustively(edgeIndex + 1, covered, weight, cardinality, maxWeight, maxCardinality, maxWeightOfMaxCardinality);
+    stIntTuple *edge = stList_get(edgesList, edgeIndex);
+    int64_t from = stIntTuple_get(edge, 0), to = stIntTuple_get(edge, 1);
+    if(!covered[from] && !covered[to]) {
+        covered[from] = 1;
+        covered[to] = 1;
+        getOptimalMatchingsExhaustively(edgeIndex + 1, covered, weight + stIntTuple_get(edge, 2), cardinality + 1,
+                maxWeight, maxCardinality, maxWeightOfMaxCardinality);
+        covered[from] = 0;
+        covered[to] = 0;
+    }
+}
+
+static void testOptimalMatchingsExhaustively(CuTest *testCase) {
+    /*
+     * Checks the maximum weight and maximum cardinality matchings against all the matchings of small random graphs.
+     */
+    for(int64_t i=0; i<100; i++) {
+        teardown();
+        nodeNumber = st_randomInt(0, 9);
+        edgesList = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        stSortedSet *seen = getEmptyNodeOrEdgeSetWithCleanup();
+        for(int64_t j=0; j<nodeNumber * 2; j++) {
+            int64_t from = st_randomInt(0, nodeNumber);
+            int64_t to = st_randomInt(0, nodeNumber);
+            if(from != to && !edgeInSet(seen, from, to)) {
+                addEdgeToSet(seen, from, to);
+                addWeightedEdgeToList(from, to, st_randomInt(0, 100), edgesList);
+            }
+        }
+        stSortedSet_destruct(seen);
+        edges = stList_getSortedSet(edgesList, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+        bool *covered = st_calloc(nodeNumber + 1, sizeof(bool));
+        int64_t maxWeight = 0, maxCardinality = 0, maxWeightOfMaxCardinality = 0;
+        getOptimalMatchingsExhaustively(0, covered, 0, 0, &maxWeight, &maxCardinality, &maxWeightOfMaxCardinality);
+        free(covered);
+        stList *maximumWeightMatching = chooseMatching_maximumWeightMatching(edgesList, nodeNumber);
+        stList *maximumCardinalityMatching = chooseMatching_maximumCardinalityMatching(edgesList, nodeNumber);
+        checkMatching(testCase, maximumWeightMatching, 0);
+        checkMatching(testCase, maximumCardinalityMatching, 0);
+        CuAssertIntEquals(testCase, maxWeight, matchingWeight(maximumWeightMatching));
+        CuAssertIntEquals(testCase, maxCardinality, stList_length(maximumCardinalityMatching));
+        CuAssertIntEquals(testCase, maxWeightOfMaxCardinality, matchingWeight(maximumCardinalityMatching));
+        //The Edmonds algorithm used for large weights.
+        stList *edmondsMatching = chooseMatching_edmonds(edgesList, nodeNumber, 0);
+        stList *edmondsCardinalityMatching = chooseMatching_edmonds(edgesList, nodeNumber, 1);
+        checkMatching(testCase, edmondsMatching, 0);
+        checkMatching(testCase, edmondsCardinalityMatching, 0);
+        CuAssertIntEquals(testCase, maxWeight, matchingWeight(edmondsMatching));
+        CuAssertIntEquals(testCase, maxCardinality, stList_length(edmondsCardinalityMatching));
+        CuAssertIntEquals(testCase, maxWeightOfMaxCardinality, matchingWeight(edmondsCardinalityMatching));
+        stList_destruct(maximumWeightMatching);
+        stList_destruct(maximumCardinalityMatching);
+        stList_destruct(edmondsMatching);
+        stList_destruct(edmondsCardinalityMatching);
+    }
+    teardown();
+}
+
+static void testLargeWeights(CuTest *testCase) {
+    /*
+     * Scales the weights of random graphs beyond the range of blossom5, or beyond the range in which blossom5 can break
+     * ties between maximum cardinality matchings by weight, and checks the matchings are those of the unscaled graphs.
+     */
+    for(int64_t i=0; i<100; i++) {
+        setup();
+        int64_t scale = i % 2 == 0 ? chooseMatching_getMaximumBlossom5Weight() : chooseMatching_getMaximumBlossom5Weight() / 200;
+        stList *scaledEdges = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        for(int64_t j=0; j<stList_length(edgesList); j++) {
+            stIntTuple *edge = stList_get(edgesList, j);
+            addWeightedEdgeToList(stIntTuple_get(edge, 0), stIntTuple_get(edge, 1), stIntTuple_get(edge, 2) * scale, scaledEdges);
+        }
+        stList *maximumWeightMatching = chooseMatching_maximumWeightMatching(edgesList, nodeNumber);
+        stList *maximumCardinalityMatching = chooseMatching_maximumCardinalityMatching(edgesList, nodeNumber);
+        stList *scaledMaximumWeightMatching = chooseMatching_maximumWeightMatching(scaledEdges, nodeNumber);
+        stList *scaledMaximumCardinalityMatching = chooseMatching_maximumCardinalityMatching(scaledEdges, nodeNumber);
+        CuAssertTrue(testCase, matchingWeight(maximumWeightMatching) * scale == matchingWeight(scaledMaximumWeightMatching));
+        CuAssertIntEquals(testCase, stList_length(maximumCardinalityMatching), stList_length(scaledMaximumCardinalityMatching));
+        CuAssertTrue(testCase, matchingWeight(maximumCardinalityMatching) * scale == matchingWeight(scaledMaximumCardinalityMatching));
+        stList_destruct(maximumWeightMatching);
+        stList_destruct(maximumCardinalityMatching);
+        stList_destruct(scaledMaximumWeightMatching);
+        stList_destruct(scaledMaximumCardinalityMatching);
+        stList_destruct(scaledEdges);
+        teardown();
+    }
+}
+
+static void testApproximateMatchings(CuTest *testCase) {
+    /*
+     * Checks the path growing and locally dominant matchings are valid and have at least half the weight of the
+     * maximum weight matching, that short augmentations do not decrease the weight and that the locally dominant
+     * matching does not depend on the number of threads.
+     */
+    for(int64_t i=0; i<100; i++) {
+        setup();
+        stList *maximumWeightMatching = chooseMatching_maximumWeightMatching(edgesList, nodeNumber);
+        stList *pathGrowingMatching = chooseMatching_pathGrowing(edgesList, nodeNumber);
+        stList *augmentedMatching = chooseMatching_pathGrowingWithAugmentations(edgesList, nodeNumber);
+        stList *locallyDominantMatching = chooseMatching_locallyDominant2(edgesList, nodeNumber, 1);
+        stList *locallyDominantMatching2 = chooseMatching_locallyDominant2(edgesList, nodeNumber, 4);
+        checkMatching(testCase, pathGrowingMatching, 0);
+        checkMatching(testCase, augmentedMatching, 0);
+        checkMatching(testCase, locallyDominantMatching, 0);
+        int64_t maxWeight = matchingWeight(maximumWeightMatching);
+        int64_t pathGrowingWeight = matchingWeight(pathGrowingMatching);
+        int64_t augmentedWeight = matchingWeight(augmentedMatching);
+        st_logInfo("The total weight of the maximum weight matching is %" PRIi64 ", the total weight of the path growing matching is %" PRIi64 ", the total weight of the augmented matching is %" PRIi64 "\n",
+                maxWeight, pathGrowingWeight, augmentedWeight);
+        CuAssertTrue(testCase, 2 * pathGrowingWeight >= maxWeight);
+        CuAssertTrue(testCase, pathGrowingWeight <= augmentedWeight);
+        CuAssertTrue(testCase, augmentedWeight <= maxWeight);
+        CuAssertTrue(testCase, 2 * matchingWeight(locallyDominantMatching) >= maxWeight);
+        CuAssertIntEquals(testCase, stList_length(locallyDominantMatching), stList_length(locallyDominantMatching2));
+        for(int64_t j=0; j<stList_length(locallyDominantMatching); j++) {
+            CuAssertTrue(testCase, stList_get(locallyDominantMatching, j) == stList_get(locallyDominantMatching2, j));
+        }
+        stList_destruct(maximumWeightMatching);
+        stList_destruct(pathGrowingMatching);
+        stList_destruct(augmentedMatching);
+        stList_destruct(locallyDominantMatching);
+        stList_destruct(locallyDominantMatching2);
+        teardown();
+    }
+}
+
+static void testLocallyDominantInParallel(CuTest *testCase) {
+    /*
+     * Checks the locally dominant matching of a graph large enough to be split between threads does not depend on
+     * the number of threads.
+     */
+    teardown();
+    nodeNumber = 50000;
+    edgesList = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    for(int64_t i=0; i<nodeNumber * 3; i++) {
+        int64_t from = st_randomInt(0, nodeNumber);
+        int64_t to = st_randomInt(0, nodeNumber);
+        if(from != to) {
+            addWeightedEdgeToList(from, to, st_randomInt(0, 100), edgesList);
+        }
+    }
+    stList *matching = chooseMatching_locallyDominant2(edgesList, nodeNumber, 1);
+    stList *matching2 = chooseMatching_locallyDominant2(edgesList, nodeNumber, 4);
+    CuAssertIntEquals(testCase, stList_length(matching), stList_length(matching2));
+    for(int64_t i=0; i<stList_length(matching); i++) {
+        CuAssertTrue(testCase, stList_get(matching, i) == stList_get(matching2, i));
+    }
+    stList_destruct(matching);
+    stList_destruct(matching2);
+    stList_destruct(edgesList);
+    edgesList = NULL;
+    nodeNumber = 0;
+}
+
+static stList *chooseMatching_greedyCopies(stList *edges, int64_t nodeNumber) {
+    /*
+     * The greedy matching, returned as new edges of length 3 rather than the edges given.
+     */
+    stList *matching = chooseMatching_greedy(edges, nodeNumber);
+    stList *copies = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    for(int64_t i=0; i<stList_length(matching); i++) {
+        stIntTuple *edge = stList_get(matching, i);
+        stList_append(copies, constructWeightedEdge(stIntTuple_get(edge, 0), stIntTuple_get(edge, 1), stIntTuple_get(edge, 2)));
+    }
+    stList_destruct(matching);
+    return copies;
+}
+
+static void testSparseMatchingByComponents(CuTest *testCase) {
+    /*
+     * Makes graphs of many small components and one large one, with gaps in the node numbering, and checks matching the
+     * components separately gives valid matchings of the same weight as matching the whole graph.
+     */
+    for(int64_t i=0; i<20; i++) {
+        teardown();
+        stSortedSet *nodes = getEmptyNodeOrEdgeSetWithCleanup();
+        edgesList = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        stSortedSet *seen = getEmptyNodeOrEdgeSetWithCleanup();
+        int64_t firstNode = 0;
+        int64_t spacing = i % 2 == 0 ? 3 : 1000; //Nodes that are compact or spread out are rebased differently.
+        while(firstNode < 500) {
+            int64_t componentSize = st_random() > 0.9 ? st_randomInt(10, 100) : st_randomInt(1, 6);
+            for(int64_t j=0; j<componentSize; j++) {
+                addNodeToSet(nodes, spacing * (firstNode + j));
+            }
+            for(int64_t j=0; j<componentSize * 2; j++) {
+                int64_t from = spacing * (firstNode + st_randomInt(0, componentSize));
+                int64_t to = spacing * (firstNode + st_randomInt(0, componentSize));
+                if(from != to && !edgeInSet(seen, from, to)) {
+                    addEdgeToSet(seen, from, to);
+                    addWeightedEdgeToList(from, to, st_randomInt(0, 100), edgesList);
+                }
+            }
+            firstNode += componentSize;
+        }
+        stSortedSet_destruct(seen);
+        edges = stList_getSortedSet(edgesList, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+
+        stList *matching = getSparseMatching(nodes, edgesList, chooseMatching_maximumWeightMatching);
+        stList *componentMatching = getSparseMatchingByComponents(nodes, edgesList, chooseMatching_maximumWeightMatching, 1);
+        stList *componentMatching2 = getSparseMatchingByComponents(nodes, edgesList, chooseMatching_maximumWeightMatching, 4);
+        stList *greedyComponentMatching = getSparseMatchingByComponents(nodes, edgesList, chooseMatching_greedy, 4);
+        //Algorithms that return their own edges give the same matchings, found by the nodes of the edges.
+        stList *greedyMatching = getSparseMatching(nodes, edgesList, chooseMatching_greedy);
+        stList *greedyCopiesMatching = getSparseMatching(nodes, edgesList, chooseMatching_greedyCopies);
+        stList *greedyCopiesComponentMatching = getSparseMatchingByComponents(nodes, edgesList, chooseMatching_greedyCopies, 4);
+        CuAssertIntEquals(testCase, stList_length(greedyMatching), stList_length(greedyCopiesMatching));
+        for(int64_t j=0; j<stList_length(greedyMatching); j++) {
+            CuAssertTrue(testCase, stList_get(greedyMatching, j) == stList_get(greedyCopiesMatching, j));
+        }
+        CuAssertIntEquals(testCase, stList_length(greedyComponentMatching), stList_length(greedyCopiesComponentMatching));
+        for(int64_t j=0; j<stList_length(greedyComponentMatching); j++) {
+            CuAssertTrue(testCase, stList_get(greedyComponentMatching, j) == stList_get(greedyCopiesComponentMatching, j));
+        }
+        stList_destruct(greedyMatching);
+        stList_destruct(greedyCopiesMatching);
+        stList_destruct(greedyCopiesComponentMatching);
+        stList *matchings[] = { componentMatching, componentMatching2, greedyComponentMatching };
+        for(int64_t j=0; j<3; j++) {
+            stSortedSet *matchedNodes = getEmptyNodeOrEdgeSetWithCleanup();
+            for(int64_t k=0; k<stList_length(matchings[j]); k++) {
+                stIntTuple *edge = stList_get(matchings[j], k);
+                CuAssertTrue(testCase, stSortedSet_search(edges, edge) != NULL);
+                CuAssertTrue(testCase, !nodeInSet(matchedNodes, stIntTuple_get(edge, 0)));
+                CuAssertTrue(testCase, !nodeInSet(matchedNodes, stIntTuple_get(edge, 1)));
+                addNodeToSet(matchedNodes, stIntTuple_get(edge, 0));
+                addNodeToSet(matchedNodes, stIntTuple_get(edge, 1));
+            }
+            stSortedSet_destruct(matchedNodes);
+        }
+        CuAssertIntEquals(testCase, matchingWeight(matching), matchingWeight(componentMatching));
+        CuAssertIntEquals(testCase, matchingWeight(matching), matchingWeight(componentMatching2));
+        CuAssertIntEquals(testCase, stList_length(componentMatching), stList_length(componentMatching2));
+        for(int64_t j=0; j<stList_length(componentMatching); j++) {
+            CuAssertTrue(testCase, stList_get(componentMatching, j) == stList_get(componentMatching2, j));
+        }
+        stList_destruct(matching);
+        stList_destruct(componentMatching);
+        stList_destruct(componentMatching2);
+        stList_destruct(greedyComponentMatching);
+        stSortedSet_destruct(nodes);
+    }
+    //Connected graphs, which are matched as one component.
+    for(int64_t i=0; i<20; i++) {
+        teardown();
+        stSortedSet *nodes = getEmptyNodeOrEdgeSetWithCleanup();
+        edgesList = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        int64_t componentSize = st_randomInt(4, 100);
+        for(int64_t j=0; j<componentSize; j++) {
+            addNodeToSet(nodes, 7 * j);
+            if(j > 0) {
+                addWeightedEdgeToList(7 * (j - 1), 7 * j, st_randomInt(0, 100), edgesList);
+            }
+        }
+        edges = stList_getSortedSet(edgesList, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+        stList *matching = getSparseMatching(nodes, edgesList, chooseMatching_maximumWeightMatching);
+        stList *componentMatching = getSparseMatchingByComponents(nodes, edgesList, chooseMatching_maximumWeightMatching, 2);
+        CuAssertIntEquals(testCase, stList_length(matching), stList_length(componentMatching));
+        for(int64_t j=0; j<stList_length(matching); j++) {
+            CuAssertTrue(testCase, stList_get(matching, j) == stList_get(componentMatching, j));
+        }
+        stList_destruct(matching);
+        stList_destruct(componentMatching);
+        stSortedSet_destruct(nodes);
+    }
+    //A component of two nodes joined by a zero weight edge, beside one with a positive weight edge, which alone is matched.
+    teardown();
+    stSortedSet *nodes = getEmptyNodeOrEdgeSetWithCleanup();
+    edgesList = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+    for(int64_t j=0; j<4; j++) {
+        addNodeToSet(nodes, j);
+    }
+    addWeightedEdgeToList(0, 1, 0, edgesList);
+    addWeightedEdgeToList(2, 3, 5, edgesList);
+    edges = stList_getSortedSet(edgesList, (int (*)(const void *, const void *))stIntTuple_cmpFn);
+    stList *componentMatching = getSparseMatchingByComponents(nodes, edgesList, chooseMatching_maximumWeightMatching, 1);
+    CuAssertIntEquals(testCase, 1, stList_length(componentMatching));
+    CuAssertTrue(testCase, stList_get(componentMatching, 0) == stList_get(edgesList, 1));
+    stList_destruct(componentMatching);
+    stSortedSet_destruct(nodes);
+    teardown();
+}
+
+static void testMatchingSession(CuTest *testCase) {
+    /*
+     * Changes the weights of random graphs and adds edges to them, checking the matching of the session has the weight
+     * of the maximum weight matching of the changed graph.
+     */
+    for(int64_t i=0; i<100; i++) {
+        setup();
+        matchingSession *mS = matchingSession_construct(edgesList, nodeNumber);
+        for(int64_t j=0; j<5; j++) {
+            stList *matching = matchingSession_getMatching(mS);
+            stList *maximumWeightMatching = chooseMatching_maximumWeightMatching(edgesList, nodeNumber);
+            checkMatching(testCase, matching, 0);
+            CuAssertIntEquals(testCase, matchingWeight(maximumWeightMatching), matchingWeight(matching));
+            stList_destruct(matching);
+            stList_destruct(maximumWeightMatching);
+            //Change the graph, keeping edgesList and edges the same as the edges of the session.
+            for(int64_t k=0; k<stList_length(edgesList); k++) {
+                if(st_random() > 0.8) {
+                    stIntTuple *edge = stList_get(edgesList, k);
+                    stIntTuple *newEdge = constructWeightedEdge(stIntTuple_get(edge, 0), stIntTuple_get(edge, 1), st_randomInt(0, 100));
+                    matchingSession_setWeight(mS, k, stIntTuple_get(newEdge, 2));
+                    stSortedSet_remove(edges, edge);
+                    stSortedSet_insert(edges, newEdge);
+                    stList_set(edgesList, k, newEdge);
+                    stIntTuple_destruct(edge);
+                }
+            }
+            for(int64_t k=0; k<nodeNumber; k++) {
+                int64_t from = st_randomInt(0, nodeNumber);
+                int64_t to = st_randomInt(0, nodeNumber);
+                if(from != to && getWeightedEdgeFromSet(from, to, edges) == NULL) {
+                    addWeightedEdgeToList(from, to, st_randomInt(0, 100), edgesList);
+                    stSortedSet_insert(edges, stList_peek(edgesList));
+                    CuAssertIntEquals(testCase, stList_length(edgesList) - 1, matchingSession_addEdge(mS, from, to, stIntTuple_get(stList_peek(edgesList), 2)));
+                }
+            }
+        }
+        matchingSession_destruct(mS);
+        teardown();
+    }
+}
+
+static void testMatchingSessionIsQuiet(CuTest *testCase) {
+    /*
+     * Adds many edges to sessions with and without room left for them, checking the matchings and that nothing is written
+     * to stdout, as blossom5 does if it has to make room for edges itself. The checks are made once stdout is restored.
+     */
+    bool weightsCorrect = 1, indicesCorrect = 1;
+    fflush(stdout);
+    int64_t stdoutCopy = dup(fileno(stdout));
+    FILE *capturedStdout = tmpfile();
+    CuAssertTrue(testCase, stdoutCopy >= 0 && capturedStdout != NULL);
+    dup2(fileno(capturedStdout), fileno(stdout));
+    for(int64_t i=0; i<20; i++) {
+        setup();
+        matchingSession *mS = i % 2 == 0 ? matchingSession_construct(edgesList, nodeNumber) :
+                matchingSession_construct3(edgesList, nodeNumber, NULL, 0);
+        for(int64_t k=0; k<5 * nodeNumber; k++) {
+            int64_t from = st_randomInt(0, nodeNumber);
+            int64_t to = st_randomInt(0, nodeNumber);
+            if(from != to && getWeightedEdgeFromSet(from, to, edges) == NULL) {
+                addWeightedEdgeToList(from, to, st_randomInt(0, 100), edgesList);
+                stSortedSet_insert(edges, stList_peek(edgesList));
+                indicesCorrect = indicesCorrect && matchingSession_addEdge(mS, from, to, stIntTuple_get(stList_peek(edgesList), 2)) == stList_length(edgesList) - 1;
+            }
+            if(k % nodeNumber == nodeNumber - 1) {
+                stList *matching = matchingSession_getMatching(mS);
+                stList *maximumWeightMatching = chooseMatching_maximumWeightMatching(edgesList, nodeNumber);
+                weightsCorrect = weightsCorrect && matchingWeight(maximumWeightMatching) == matchingWeight(matching);
+                stList_destruct(matching);
+                stList_destruct(maximumWeightMatching);
+            }
+        }
+        matchingSession_destruct(mS);
+        teardown();
+    }
+    fflush(stdout);
+    dup2(stdoutCopy, fileno(stdout));
+    close(stdoutCopy);
+    fseek(capturedStdout, 0, SEEK_END);
+    CuAssertIntEquals(testCase, 0, ftell(capturedStdout));
+    fclose(capturedStdout);
+    CuAssertTrue(testCase, indicesCorrect);
+    CuAssertTrue(testCase, weightsCorrect);
+}
+
+static void testEdgeIndex(CuTest *testCase) {
+    /*
+     * Checks packed edges are found by their nodes, in either order, as in the sorted set of edges, and carry the
+     * position in the list of the edge they were packed from.
+     */
+    for(int64_t i=0; i<100; i++) {
+        setup();
+        packedEdge *packedEdges = getPackedEdges(edgesList);
+        edgeIndex *index = edgeIndex_construct(packedEdges, stList_length(edgesList));
+        for(int64_t from=0; from<nodeNumber; from++) {
+            for(int64_t to=0; to<nodeNumber; to++) {
+                stIntTuple *edge = from != to ? getWeightedEdgeFromSet(from, to, edges) : NULL;
+                packedEdge *packed = edgeIndex_getEdge(index, from, to);
+                CuAssertTrue(testCase, (packed == NULL) == (edge == NULL));
+                if(packed != NULL) {
+                    CuAssertIntEquals(testCase, packed - packedEdges, packed->index);
+                    CuAssertTrue(testCase, stList_get(edgesList, packed->index) == edge);
+                    CuAssertIntEquals(testCase, stIntTuple_get(edge, 2), packed->weight);
+                }
+            }
+        }
+        edgeIndex_destruct(index);
+        free(packedEdges);
+        teardown();
+    }
+}
+
+static void testBlossom5Options(CuTest *testCase) {
+    /*
+     * Checks the maximum weight and cardinality matchings do not depend on the solver options.
+     */
+    for(int64_t i=0; i<100; i++) {
+        setup();
+        blossom5Options options = blossom5Options_getDefault();
+        options.fractionalJumpstart = st_random() > 0.5;
+        options.dualGreedyUpdateOption = st_randomInt(0, 2);
+        options.updateDualsBefore = st_random() > 0.5;
+        options.updateDualsAfter = st_random() > 0.5;
+        options.singleTreeThreshold = st_random();
+        stList *maximumWeightMatching = chooseMatching_maximumWeightMatching(edgesList, nodeNumber);
+        stList *maximumWeightMatching2 = chooseMatching_maximumWeightMatching2(edgesList, nodeNumber, &options);
+        stList *maximumCardinalityMatching = chooseMatching_maximumCardinalityMatching(edgesList, nodeNumber);
+        stList *maximumCardinalityMatching2 = chooseMatching_maximumCardinalityMatching2(edgesList, nodeNumber, &options);
+        checkMatching(testCase, maximumWeightMatching2, 0);
+        checkMatching(testCase, maximumCardinalityMatching2, 0);
+        CuAssertIntEquals(testCase, matchingWeight(maximumWeightMatching), matchingWeight(maximumWeightMatching2));
+        CuAssertIntEquals(testCase, stList_length(maximumCardinalityMatching), stList_length(maximumCardinalityMatching2));
+        CuAssertIntEquals(testCase, matchingWeight(maximumCardinalityMatching), matchingWeight(maximumCardinalityMatching2));
+        stList_destruct(maximumWeightMatching);
+        stList_destruct(maximumWeightMatching2);
+        stList_destruct(maximumCardinalityMatching);
+        stList_destruct(maximumCardinalityMatching2);
+        teardown();
+    }
+}
+
 CuSuite* matchingAlgorithmsTestSuite(void) {
     CuSuite* suite = CuSuiteNew();
     SUITE_ADD_TEST(suite, testGreedy);
     SUITE_ADD_TEST(suite, testMaximumWeight);
     SUITE_ADD_TEST(suite, testMaximumCardinality);
+    SUITE_ADD_TEST(suite, testOptimalMatchingsExhaustively);
+    SUITE_ADD_TEST(suite, testLargeWeights);
+    SUITE_ADD_TEST(suite, testApproximateMatchings);
+    SUITE_ADD_TEST(suite, testLocallyDominantInParallel);
+    SUITE_ADD_TEST(suite, testSparseMatchingByComponents);
+    SUITE_ADD_TEST(suite, testMatchingSession);
+    SUITE_ADD_TEST(suite, testMatchingSessionIsQuiet);
+    SUITE_ADD_TEST(suite, testBlossom5Options);
+    SUITE_ADD_TEST(suite, testEdgeIndex);
 
     return suite;
 }
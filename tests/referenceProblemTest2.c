@@ -277,10 +277,154 @@ static void testReference_splitInterval(CuTest *testCase) {
     }
 }
 
+static void testReference_splitIntervalAtNodes(CuTest *testCase) {
+    for (int64_t i = 0; i < testNumber; i++) {
+        setup();
+        fillReference();
+        checkIsValidReference(testCase);
+        for (int64_t j = reference_getIntervalNumber(ref) - 1; j >= 0; j--) {
+            //Choose random split points within the interval
+            int64_t first = reference_getFirstOfInterval(ref, j);
+            int64_t last = reference_getLast(ref, first);
+            stList *pNodes = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+            int64_t n = first;
+            while (n != last) {
+                if (st_random() > 0.5) {
+                    stList_append(pNodes, stIntTuple_construct1(n));
+                }
+                n = reference_getNext(ref, n);
+            }
+            int64_t k = reference_getIntervalNumber(ref);
+            stList *newStubs = reference_splitIntervalAtNodes(ref, pNodes);
+            CuAssertIntEquals(testCase, 2 * stList_length(pNodes), stList_length(newStubs));
+            CuAssertIntEquals(testCase, k + stList_length(pNodes), reference_getIntervalNumber(ref));
+            //Check each split point is now followed by a stub ending its interval, and the next piece starts with the other stub
+            int64_t pFirst = first;
+            for (int64_t l = 0; l < stList_length(pNodes); l++) {
+                int64_t pNode = stIntTuple_get(stList_get(pNodes, l), 0);
+                int64_t stub1 = stIntTuple_get(stList_get(newStubs, 2 * l), 0);
+                int64_t stub2 = -stIntTuple_get(stList_get(newStubs, 2 * l + 1), 0);
+                CuAssertTrue(testCase, stub1 > nodeNumber && stub2 > nodeNumber);
+                CuAssertIntEquals(testCase, stub1, reference_getNext(ref, pNode));
+                CuAssertIntEquals(testCase, INT64_MAX, reference_getNext(ref, stub1));
+                CuAssertIntEquals(testCase, pFirst, reference_getFirst(ref, pNode));
+                CuAssertIntEquals(testCase, pFirst, reference_getFirst(ref, stub1));
+                CuAssertIntEquals(testCase, stub2, reference_getFirstOfInterval(ref, k + l));
+                CuAssertIntEquals(testCase, stub2, reference_getFirst(ref, reference_getNext(ref, stub2)));
+                pFirst = stub2;
+            }
+            CuAssertIntEquals(testCase, pFirst, reference_getFirst(ref, last));
+            nodeNumber += stList_length(newStubs);
+            intervalNumber += stList_length(pNodes);
+            checkIsValidReference(testCase);
+            stList_destruct(pNodes);
+            stList_destruct(newStubs);
+        }
+        teardown();
+    }
+}
+
+static void testReference_replaceIntervalContents(CuTest *testCase) {
+    for (int64_t i = 0; i < testNumber; i++) {
+        setup();
+        fillReference();
+        checkIsValidReference(testCase);
+        for (int64_t j = 0; j < reference_getIntervalNumber(ref); j++) {
+            //Get the inner nodes of the interval in a random order
+            int64_t first = reference_getFirstOfInterval(ref, j);
+            int64_t last = reference_getLast(ref, first);
+            stList *nodes = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+            int64_t n = reference_getNext(ref, first);
+            while (n != last) {
+                stList_append(nodes, stIntTuple_construct1(n));
+                n = reference_getNext(ref, n);
+            }
+            for (int64_t k = stList_length(nodes) - 1; k > 0; k--) {
+                int64_t l = st_randomInt(0, k + 1);
+                stIntTuple *node = stList_get(nodes, k);
+                stList_set(nodes, k, stList_get(nodes, l));
+                stList_set(nodes, l, node);
+            }
+            reference_replaceIntervalContents(ref, first, nodes);
+            //Check the interval now contains the nodes in the given order
+            n = first;
+            for (int64_t k = 0; k < stList_length(nodes); k++) {
+                int64_t m = stIntTuple_get(stList_get(nodes, k), 0);
+                CuAssertIntEquals(testCase, m, reference_getNext(ref, n));
+                CuAssertIntEquals(testCase, n, reference_getPrevious(ref, m));
+                CuAssertTrue(testCase, reference_cmp(ref, n, m) == -1);
+                CuAssertIntEquals(testCase, first, reference_getFirst(ref, m));
+                n = m;
+            }
+            CuAssertIntEquals(testCase, last, reference_getNext(ref, n));
+            CuAssertTrue(testCase, reference_cmp(ref, n, last) == -1);
+            stList_destruct(nodes);
+        }
+        CuAssertIntEquals(testCase, intervalNumber, reference_getIntervalNumber(ref));
+        checkIsValidReference(testCase);
+        teardown();
+    }
+}
+
 bool toySplitFn(int64_t pNode, refOrdering *ref, void *extraArgs) {
     return st_random() > 0.5;
 }
 
+static void testRemakeReferenceIntervals(CuTest *testCase) {
+    for (int64_t i = 0; i < testNumber; i++) {
+        setup();
+        fillReference();
+        //Record the intervals and their contents
+        stList *intervals = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        stList *nodes = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        for (int64_t j = 0; j < reference_getIntervalNumber(ref); j++) {
+            int64_t n = reference_getFirstOfInterval(ref, j);
+            stList_append(intervals, stIntTuple_construct2(n, reference_getLast(ref, n)));
+            while (n != INT64_MAX) {
+                stList_append(nodes, stIntTuple_construct1(n));
+                n = reference_getNext(ref, n);
+            }
+        }
+        //Break some of the intervals in two, then join them back together
+        stList *newStubs = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+        for (int64_t j = 0; j < intervalNumber; j++) {
+            if (st_random() > 0.5) {
+                int64_t n = reference_getFirstOfInterval(ref, j);
+                while (reference_getNext(ref, reference_getNext(ref, n)) != INT64_MAX && st_random() > 0.3) {
+                    n = reference_getNext(ref, n);
+                }
+                stList *pNodes = stList_construct3(0, (void (*)(void *))stIntTuple_destruct);
+                stList_append(pNodes, stIntTuple_construct1(n));
+                stList *stubs = reference_splitIntervalAtNodes(ref, pNodes);
+                stList_appendAll(newStubs, stubs);
+                stList_setDestructor(stubs, NULL);
+                stList_destruct(stubs);
+                stList_destruct(pNodes);
+            }
+        }
+        CuAssertIntEquals(testCase, intervalNumber + stList_length(newStubs) / 2, reference_getIntervalNumber(ref));
+        stList *remainingStubs = remakeReferenceIntervals(ref, intervals, newStubs);
+        CuAssertIntEquals(testCase, 0, stList_length(remainingStubs));
+        CuAssertIntEquals(testCase, intervalNumber, reference_getIntervalNumber(ref));
+        int64_t k = 0;
+        for (int64_t j = 0; j < reference_getIntervalNumber(ref); j++) {
+            int64_t n = reference_getFirstOfInterval(ref, j);
+            CuAssertIntEquals(testCase, stIntTuple_get(stList_get(intervals, j), 1), reference_getLast(ref, n));
+            while (n != INT64_MAX) {
+                CuAssertIntEquals(testCase, stIntTuple_get(stList_get(nodes, k++), 0), n);
+                n = reference_getNext(ref, n);
+            }
+        }
+        CuAssertIntEquals(testCase, stList_length(nodes), k);
+        checkIsValidReference(testCase);
+        stList_destruct(remainingStubs);
+        stList_destruct(newStubs);
+        stList_destruct(intervals);
+        stList_destruct(nodes);
+        teardown();
+    }
+}
+
 static void testMakeReferenceGreedily(CuTest *testCase) {
     long double maxScore = 0, achievedScore = 0;
     for (int64_t i = 0; i < testNumber; i++) {
@@ -341,6 +485,37 @@ static void fn(double theta, int64_t node1, int64_t node2, int64_t adjacencyLeng
     refAdjList_setWeight(aL, node1, node2, refAdjList_getWeight(aL, node1, node2) + d);
 }
 
+static void testZScoreCalculator(CuTest *testCase) {
+    for (int64_t i = 0; i < testNumber; i++) {
+        long double theta = i == 0 ? 0.0 : (i == 1 ? 1.0 : st_random() * 0.01);
+        int64_t maxLength = st_randomInt(0, 1000);
+        zScoreCalculator *zS = zScoreCalculator_construct(theta, maxLength);
+        int64_t length = st_randomInt(0, 100);
+        int64_t *n = st_malloc(sizeof(int64_t) * (length + 1)), *m = st_malloc(sizeof(int64_t) * (length + 1)),
+                *k = st_malloc(sizeof(int64_t) * (length + 1));
+        long double *zScores = st_malloc(sizeof(long double) * (length + 1));
+        for (int64_t j = 0; j < length; j++) {
+            n[j] = st_randomInt(0, 2 * maxLength + 1); //Includes lengths outside of the tables
+            m[j] = st_randomInt(0, 2 * maxLength + 1);
+            k[j] = st_randomInt(0, 2 * maxLength + 1);
+            if (theta < 1.0 && st_random() < 0.1) { //Negative lengths must also miss the tables
+                n[j] = -st_randomInt(1, 10);
+            }
+        }
+        zScoreCalculator_getBatch(zS, n, m, k, zScores, length);
+        for (int64_t j = 0; j < length; j++) {
+            long double z = calculateZScore(n[j], m[j], k[j], theta);
+            CuAssertDblEquals(testCase, z, zScoreCalculator_get(zS, n[j], m[j], k[j]), fabsl(z) * 1e-9 + 1e-12);
+            CuAssertDblEquals(testCase, z, zScores[j], fabsl(z) * 1e-9 + 1e-12);
+        }
+        free(n);
+        free(m);
+        free(k);
+        free(zScores);
+        zScoreCalculator_destruct(zS);
+    }
+}
+
 static void testADBDCExample(CuTest *testCase) {
     /*
      * Tests example from paper.
@@ -398,8 +573,12 @@ CuSuite* referenceProblem2TestSuite(void) {
     SUITE_ADD_TEST(suite, testReferenceRandom);
     SUITE_ADD_TEST(suite, testMakeReferenceGreedily);
     SUITE_ADD_TEST(suite, testReference_splitInterval);
+    SUITE_ADD_TEST(suite, testReference_splitIntervalAtNodes);
+    SUITE_ADD_TEST(suite, testReference_replaceIntervalContents);
     SUITE_ADD_TEST(suite, testReference_getMaximumNode);
     SUITE_ADD_TEST(suite, testReference_removeIntervals);
+    SUITE_ADD_TEST(suite, testRemakeReferenceIntervals);
+    SUITE_ADD_TEST(suite, testZScoreCalculator);
     SUITE_ADD_TEST(suite, testADBDCExample);
     return suite;
 }